@@ -0,0 +1,467 @@
+//vanunuraz@gmail.com
+//This header defines thread-safe wrappers around "MyContainer" for programs where several threads read and write the same container.
+
+//"ConcurrentContainer" uses reader/writer locking: many reader threads can build and walk iterators at the same time (shared lock), and a writer
+//that adds or removes elements takes the lock exclusively. The generation (changes counter) of the inner container is an atomic 64-bit value, so
+//iterators can keep checking it without the lock. Readers get the published snapshot of the current generation without taking any lock.
+
+//"AppendLog" is a lock-free multi-producer append buffer for ingest threads. Elements are stored in chunked segments that never move, and each
+//producer reserves its slot with one atomic fetch_add, so N producers append at the same time without a mutex. A consumer takes a snapshot of
+//the consistent prefix (all slots before the first one that is still being written) as a regular MyContainer and iterates it.
+
+//"ShardedContainer" splits the elements between several MyContainer shards, one for each thread (by default one for each core). A thread always
+//appends to its own shard, so appends from different threads never touch the same lock or changes counter. Ascending and descending iteration
+//merge the cached sorted runs of all the shards lazily (k-way merge with a heap of cursors), and Order concatenates the insertion order of the shards.
+
+#pragma once
+#include <mutex>
+#include <shared_mutex>
+#include <array>
+#include <bit>
+#include <new>
+#include <memory>
+#include <thread>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    template <typename T=int>
+    class ConcurrentContainer{
+        private:
+            MyContainer<T> container; //The wrapped container, accessed only while holding the lock
+            mutable shared_mutex lock; //Shared for readers, exclusive for writers
+
+        public:
+            ConcurrentContainer() = default;
+
+            //Writers: take the lock exclusively, so no reader copies the data while it changes
+            void addElement(const T& element){
+                unique_lock<shared_mutex> guard(lock);
+                container.addElement(element);
+            }
+
+            void remove(const T& element){
+                unique_lock<shared_mutex> guard(lock);
+                container.remove(element); //Throws invalid_argument like MyContainer if the element is not found
+            }
+
+            //Readers: take the lock in shared mode, so many readers run together
+            size_t size() const{
+                shared_lock<shared_mutex> guard(lock);
+                return container.size();
+            }
+
+            //Current generation of the container. Lock-free because the counter is atomic.
+            uint64_t getChanges() const{
+                return container.getChanges();
+            }
+
+            //Run a function on the container while holding the shared lock. Inside the function the container can not change, so a begin/end pair
+            //of any order is always consistent and the full traversal never throws.
+            template<typename Func>
+            decltype(auto) read(Func&& func) const{
+                shared_lock<shared_mutex> guard(lock);
+                return std::forward<Func>(func)(static_cast<const MyContainer<T>&>(container));
+            }
+
+            //Copy of the container under the shared lock, for long traversals that should not hold the lock.
+            MyContainer<T> snapshot() const{
+                shared_lock<shared_mutex> guard(lock);
+                return container;
+            }
+
+            friend ostream& operator<<(ostream& os, const ConcurrentContainer<T>& concurrent){
+                shared_lock<shared_mutex> guard(concurrent.lock);
+                return os<< concurrent.container;
+            }
+
+        private:
+            //Lock-free fast path: if the container already published a snapshot of the current generation, use it without any lock. Only the
+            //first reader after a write takes the shared lock to make the new snapshot.
+            shared_ptr<const OrderSnapshot<T>> currentSnapshot() const{
+                shared_ptr<const OrderSnapshot<T>> current= container.publishedSnapshot();
+                if(!current){
+                    shared_lock<shared_mutex> guard(lock);
+                    current= container.snapshot();
+                }
+                return current;
+            }
+
+        public:
+        //Iterator Accessors: each iterator shares the snapshot of its generation. After that, the iterator only reads the atomic generation, so it
+        //can be used without the lock and throws (like in MyContainer) if a writer changed the container in the meantime.
+        using AscendingOrder= typename MyContainer<T>::AscendingOrder;
+        using DescendingOrder= typename MyContainer<T>::DescendingOrder;
+        using ReverseOrder= typename MyContainer<T>::ReverseOrder;
+        using Order= typename MyContainer<T>::Order;
+        using SideCrossOrder= typename MyContainer<T>::SideCrossOrder;
+        using MiddleOutOrder= typename MyContainer<T>::MiddleOutOrder;
+
+        AscendingOrder begin_ascending_order() const{ return AscendingOrder(currentSnapshot(), container.getChangesPointer(), false); }
+        AscendingOrder end_ascending_order() const{ return AscendingOrder(currentSnapshot(), container.getChangesPointer(), true); }
+
+        DescendingOrder begin_descending_order() const{ return DescendingOrder(currentSnapshot(), container.getChangesPointer(), false); }
+        DescendingOrder end_descending_order() const{ return DescendingOrder(currentSnapshot(), container.getChangesPointer(), true); }
+
+        ReverseOrder begin_reverse_order() const{ return ReverseOrder(currentSnapshot(), container.getChangesPointer(), false); }
+        ReverseOrder end_reverse_order() const{ return ReverseOrder(currentSnapshot(), container.getChangesPointer(), true); }
+
+        Order begin_order() const{ return Order(currentSnapshot(), container.getChangesPointer(), false); }
+        Order end_order() const{ return Order(currentSnapshot(), container.getChangesPointer(), true); }
+
+        SideCrossOrder begin_side_cross_order() const{ return SideCrossOrder(currentSnapshot(), container.getChangesPointer(), false); }
+        SideCrossOrder end_side_cross_order() const{ return SideCrossOrder(currentSnapshot(), container.getChangesPointer(), true); }
+
+        MiddleOutOrder begin_middle_out_order() const{ return MiddleOutOrder(currentSnapshot(), container.getChangesPointer(), false); }
+        MiddleOutOrder end_middle_out_order() const{ return MiddleOutOrder(currentSnapshot(), container.getChangesPointer(), true); }
+    }; //End of ConcurrentContainer class
+
+    template <typename T=int>
+    class AppendLog{
+        private:
+            //Segment s holds FirstSegmentSize << s slots, so the capacity doubles with each segment and an existing slot never moves
+            static constexpr size_t FirstSegmentSize= 1024;
+            static constexpr size_t MaxSegments= 40;
+
+            //One slot for one element. ready is set only after the element was constructed, so a consumer never reads a half written slot.
+            struct Slot{
+                atomic<bool> ready{false};
+                alignas(T) unsigned char storage[sizeof(T)];
+
+                const T& value() const{
+                    return *std::launder(reinterpret_cast<const T*>(storage));
+                }
+            };
+
+            array<atomic<Slot*>, MaxSegments> segments{}; //Segments are allocated on demand, by the producer of their first slot
+            atomic<size_t> reserved{0}; //Next free slot index
+            mutable atomic<size_t> prefix{0}; //Known length of the consistent prefix, only grows
+
+            //Find the segment and the offset inside it for a global slot index
+            static size_t segmentOf(size_t index){
+                return bit_width(index/ FirstSegmentSize+ 1)- 1;
+            }
+            static size_t segmentStart(size_t segment){
+                return FirstSegmentSize* ((size_t(1)<< segment)- 1);
+            }
+
+            //Marker stored instead of a segment whose allocation failed, so the producers waiting for it throw instead of waiting forever
+            static Slot* failedSegment(){
+                static Slot marker;
+                return &marker;
+            }
+
+            //Return the segment of a reserved index. Each segment is allocated once, by the producer that reserved its first slot; the other
+            //producers that reach the segment before it is ready wait on its pointer. So producers that cross a segment boundary together do not
+            //all allocate (and zero-fill) a segment that only one of them keeps.
+            Slot* ensureSegment(size_t segment, size_t index){
+                Slot* slots= segments[segment].load(memory_order_acquire);
+                if(slots== nullptr && index== segmentStart(segment)){
+                    try{
+                        slots= new Slot[FirstSegmentSize<< segment];
+                    }
+                    catch(...){
+                        segments[segment].store(failedSegment(), memory_order_release);
+                        segments[segment].notify_all();
+                        throw;
+                    }
+                    segments[segment].store(slots, memory_order_release);
+                    segments[segment].notify_all();
+                }
+                while(slots== nullptr){
+                    segments[segment].wait(nullptr, memory_order_acquire);
+                    slots= segments[segment].load(memory_order_acquire);
+                }
+                if(slots== failedSegment()){
+                    throw bad_alloc();
+                }
+                return slots;
+            }
+
+            //Slot of an index for a reader, or nullptr if its segment does not exist yet
+            const Slot* findSlot(size_t index) const{
+                size_t segment= segmentOf(index);
+                const Slot* slots= segments[segment].load(memory_order_acquire);
+                return slots== nullptr || slots== failedSegment()? nullptr: &slots[index- segmentStart(segment)];
+            }
+
+        public:
+            AppendLog() = default;
+            AppendLog(const AppendLog&) = delete; //Producers hold references to the slots, so the log is not copyable
+            AppendLog& operator=(const AppendLog&) = delete;
+
+            //Destroy all the elements and segments. Must not run while producers are still appending.
+            ~AppendLog(){
+                size_t count= reserved.load(memory_order_acquire);
+                for(size_t segment= 0; segment< MaxSegments; ++segment){
+                    Slot* slots= segments[segment].load(memory_order_acquire);
+                    if(slots== nullptr || slots== failedSegment()){
+                        continue;
+                    }
+                    size_t start= segmentStart(segment);
+                    for(size_t i= 0; i< (FirstSegmentSize<< segment) && start+ i< count; ++i){
+                        if(slots[i].ready.load(memory_order_acquire)){
+                            slots[i].value().~T();
+                        }
+                    }
+                    delete[] slots;
+                }
+            }
+
+            //Lock-free append: reserve a slot index, construct the element in place and mark the slot as ready
+            void addElement(const T& element){
+                size_t index= reserved.fetch_add(1, memory_order_relaxed);
+                size_t segment= segmentOf(index);
+                if(segment>= MaxSegments){
+                    throw length_error("AppendLog is full");
+                }
+                Slot& slot= ensureSegment(segment, index)[index- segmentStart(segment)];
+                new (slot.storage) T(element);
+                slot.ready.store(true, memory_order_release);
+            }
+
+            //Number of reserved slots, including slots that producers are still writing
+            size_t size() const{
+                return reserved.load(memory_order_acquire);
+            }
+
+            //Length of the consistent prefix: every slot before it is ready. Continues the scan from the last known prefix.
+            size_t readySize() const{
+                size_t known= prefix.load(memory_order_acquire);
+                size_t count= known;
+                size_t limit= reserved.load(memory_order_acquire);
+                while(count< limit){
+                    const Slot* slot= findSlot(count);
+                    if(slot== nullptr || !slot->ready.load(memory_order_acquire)){
+                        break;
+                    }
+                    ++count;
+                }
+                //Publish the longer prefix for the next reader. If another reader published a longer one, keep it.
+                while(count> known && !prefix.compare_exchange_weak(known, count, memory_order_acq_rel)){}
+                return max(count, known);
+            }
+
+            //Copy the consistent prefix into a regular container, in reservation order. Open an Order (or any other) iterator on the result.
+            MyContainer<T> snapshot() const{
+                size_t count= readySize();
+                vector<T> elements;
+                elements.reserve(count);
+                for(size_t i= 0; i< count; ++i){
+                    elements.push_back(findSlot(i)->value());
+                }
+                MyContainer<T> result;
+                result.addElements(make_move_iterator(elements.begin()), make_move_iterator(elements.end()));
+                return result;
+            }
+    }; //End of AppendLog class
+
+    //Small number given once to each thread, used to choose its shard. Threads get different numbers in turn, so they spread over the shards.
+    inline size_t threadTicket(){
+        static atomic<size_t> nextTicket{0};
+        static thread_local size_t ticket= nextTicket.fetch_add(1, memory_order_relaxed);
+        return ticket;
+    }
+
+    template <typename T=int>
+    class ShardedContainer{
+        private:
+            //Each shard has its own lock and counter. alignas keeps two shards out of the same cache line, so they do not slow each other down.
+            struct alignas(64) Shard{
+                mutable mutex lock;
+                MyContainer<T> container;
+            };
+
+            unique_ptr<Shard[]> shards;
+            size_t shardCount;
+
+            Shard& ownShard() const{
+                return shards[threadTicket()% shardCount];
+            }
+
+        public:
+            //One shard for each core by default
+            explicit ShardedContainer(size_t count= max(1u, thread::hardware_concurrency())):
+                shards(new Shard[max<size_t>(count, 1)]), shardCount(max<size_t>(count, 1)){}
+
+            //Append to the shard of the calling thread only
+            void addElement(const T& element){
+                Shard& shard= ownShard();
+                lock_guard<mutex> guard(shard.lock);
+                shard.container.addElement(element);
+            }
+
+            //Remove all occurrences from all the shards, or throw if no shard had the element
+            void remove(const T& element){
+                bool found= false;
+                for(size_t i= 0; i< shardCount; ++i){
+                    lock_guard<mutex> guard(shards[i].lock);
+                    try{
+                        shards[i].container.remove(element);
+                        found= true;
+                    }
+                    catch(const invalid_argument&){} //Not in this shard
+                }
+                if(!found){
+                    throw invalid_argument("Element not found in the container");
+                }
+            }
+
+            size_t size() const{
+                size_t total= 0;
+                for(size_t i= 0; i< shardCount; ++i){
+                    lock_guard<mutex> guard(shards[i].lock);
+                    total+= shards[i].container.size();
+                }
+                return total;
+            }
+
+            size_t getShardCount() const{
+                return shardCount;
+            }
+
+        private:
+            //The shared part of one merged traversal: the snapshot of each shard, the run that is read from it, and the counter of the shard with
+            //its value when the snapshot was taken. Iterators copied from one begin share it, so a copy does not touch k reference counts.
+            enum class Merge{ Ascending, Descending, Concatenated };
+            struct MergedRuns{
+                vector<shared_ptr<const OrderSnapshot<T>>> snapshots;
+                vector<const OrderBuffer<T>*> buffers;
+                vector<pair<const atomic<uint64_t>*, uint64_t>> stamps;
+                Merge merge;
+            };
+
+        public:
+        //MergedIterator: lazy iterator over a merged view of all the shards. It holds the shard snapshots and a heap with one cursor for each run
+        //that is not finished, so each step costs O(log k) and the elements are never copied. The end iterator is empty and costs nothing to make:
+        //an iterator is at the end when its heap is empty. There is no single counter for the whole container, so each step checks the counter of
+        //the shard it reads, and a change in a shard is found when the traversal reaches an element of that shard.
+        class MergedIterator{
+            private:
+                struct Cursor{
+                    size_t run;
+                    size_t pos;
+                };
+
+                shared_ptr<const MergedRuns> runs;
+                vector<Cursor> heap; //Cursor of the next element on top
+                size_t index= 0; //Number of elements already passed
+
+                //Descending reads the sorted run of the shard from the end
+                const T& value(const Cursor& cursor) const{
+                    const OrderBuffer<T>& buffer= *runs->buffers[cursor.run];
+                    return runs->merge== Merge::Descending? buffer[buffer.size()- 1- cursor.pos]: buffer[cursor.pos];
+                }
+
+                //True if cursor a comes out after cursor b (the heap keeps the largest on top). Equal elements come out in the order of the shards.
+                bool later(const Cursor& a, const Cursor& b) const{
+                    if(runs->merge== Merge::Ascending && value(a)!= value(b)){
+                        return value(b)< value(a);
+                    }
+                    if(runs->merge== Merge::Descending && value(a)!= value(b)){
+                        return value(a)< value(b);
+                    }
+                    return a.run> b.run;
+                }
+
+                auto heapOrder() const{
+                    return [this](const Cursor& a, const Cursor& b){ return later(a, b); };
+                }
+
+                const Cursor& top() const{
+                    if(heap.empty()){
+                        throw out_of_range("Iterator out of the range of the container");
+                    }
+                    const auto& [counter, generation]= runs->stamps[heap.front().run];
+                    if(counter->load(memory_order_acquire)!= generation){
+                        throw runtime_error("Iterator invalid because the container was modified");
+                    }
+                    return heap.front();
+                }
+
+            public:
+                using iterator_category= forward_iterator_tag;
+                using value_type= T;
+                using difference_type= ptrdiff_t;
+                using pointer= const T*;
+                using reference= const T&;
+
+                MergedIterator() = default; //The end of every merged view
+
+                explicit MergedIterator(shared_ptr<const MergedRuns> shared): runs(std::move(shared)){
+                    for(size_t i= 0; i< runs->buffers.size(); ++i){
+                        if(!runs->buffers[i]->empty()){
+                            heap.push_back(Cursor{i, 0});
+                        }
+                    }
+                    make_heap(heap.begin(), heap.end(), heapOrder());
+                }
+
+                const T& operator*() const{
+                    return value(top());
+                }
+                const T* operator->() const{
+                    return &value(top());
+                }
+
+                //Move the top cursor one element forward and put it back into the heap, or drop it at the end of its run
+                MergedIterator& operator++(){
+                    top();
+                    pop_heap(heap.begin(), heap.end(), heapOrder());
+                    Cursor& cursor= heap.back();
+                    if(++cursor.pos< runs->buffers[cursor.run]->size()){
+                        push_heap(heap.begin(), heap.end(), heapOrder());
+                    }
+                    else{
+                        heap.pop_back();
+                    }
+                    ++index;
+                    return *this;
+                }
+                MergedIterator operator++(int){
+                    MergedIterator tmp= *this;
+                    ++*this;
+                    return tmp;
+                }
+
+                //Two iterators are equal if both are at the end, or if they passed the same number of elements of the same traversal
+                bool operator==(const MergedIterator& other) const{
+                    if(heap.empty() || other.heap.empty()){
+                        return heap.empty() && other.heap.empty();
+                    }
+                    return runs== other.runs && index== other.index;
+                }
+                bool operator!=(const MergedIterator& other) const{
+                    return !(*this== other);
+                }
+        };
+
+        private:
+            //Take the snapshot of each shard under its lock and read the run of the merge from it. The sorted buffers are cached in the shard
+            //snapshots, so a shard that did not change since the last traversal is not sorted again.
+            MergedIterator merged(Merge merge) const{
+                auto runs= make_shared<MergedRuns>();
+                runs->merge= merge;
+                for(size_t i= 0; i< shardCount; ++i){
+                    {
+                        lock_guard<mutex> guard(shards[i].lock);
+                        runs->snapshots.push_back(shards[i].container.snapshot());
+                    }
+                    runs->stamps.emplace_back(shards[i].container.getChangesPointer(), runs->snapshots.back()->getGeneration());
+                    const OrderSnapshot<T>& snapshot= *runs->snapshots.back();
+                    runs->buffers.push_back(merge== Merge::Concatenated? &snapshot.insertion(): &snapshot.ascending());
+                }
+                return MergedIterator(std::move(runs));
+            }
+
+        public:
+        MergedIterator begin_ascending_order() const{ return merged(Merge::Ascending); }
+        MergedIterator end_ascending_order() const{ return MergedIterator(); }
+
+        MergedIterator begin_descending_order() const{ return merged(Merge::Descending); }
+        MergedIterator end_descending_order() const{ return MergedIterator(); }
+
+        MergedIterator begin_order() const{ return merged(Merge::Concatenated); }
+        MergedIterator end_order() const{ return MergedIterator(); }
+    }; //End of ShardedContainer class
+} //End of namespace exercise4
@@ -0,0 +1,106 @@
+//vanunuraz@gmail.com
+//This header prints a "MyContainer" in the same [a, b, c] format as operator<<, but much faster for large containers.
+
+//"BufferedWriter" formats the numbers with std::to_chars straight into a large reusable buffer and writes it to the stream in big blocks, instead
+//of formatting each element through the iostream machinery. writeOrder prints any of the six orders (through an OrderView), and
+//writeContainer prints the insertion order directly from the storage. Doubles are printed with the shortest text that reads back to the same
+//value (to_chars), so they can have more digits than operator<<, which uses the stream precision.
+
+#pragma once
+#include <charconv>
+#include <string_view>
+#include <type_traits>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    class BufferedWriter{
+        private:
+            static constexpr size_t MaxNumberLength= 32; //Enough for any integer or floating number from to_chars
+
+            ostream& out;
+            vector<char> buffer;
+            size_t used= 0;
+
+        public:
+            explicit BufferedWriter(ostream& stream, size_t capacity= 1<< 16): out(stream), buffer(max<size_t>(capacity, MaxNumberLength)){}
+            BufferedWriter(const BufferedWriter&) = delete;
+            BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+            //Flush what is left when the writer goes out of scope
+            ~BufferedWriter(){
+                flush();
+            }
+
+            //Write the buffer to the stream as one block and start again
+            void flush(){
+                if(used> 0){
+                    out.write(buffer.data(), static_cast<streamsize>(used));
+                    used= 0;
+                }
+            }
+
+            void write(char c){
+                if(used== buffer.size()){
+                    flush();
+                }
+                buffer[used++]= c;
+            }
+
+            void write(string_view text){
+                if(text.size()> buffer.size()- used){
+                    flush();
+                    if(text.size()> buffer.size()){ //Longer than the whole buffer: write it directly
+                        out.write(text.data(), static_cast<streamsize>(text.size()));
+                        return;
+                    }
+                }
+                std::copy(text.begin(), text.end(), buffer.data()+ used);
+                used+= text.size();
+            }
+
+            //Numbers are formatted in place in the buffer, without any temporary string
+            template<typename T>
+            void write(const T& element){
+                if constexpr(std::is_arithmetic_v<T>){
+                    if(buffer.size()- used< MaxNumberLength){
+                        flush();
+                    }
+                    auto result= std::to_chars(buffer.data()+ used, buffer.data()+ buffer.size(), element);
+                    used= static_cast<size_t>(result.ptr- buffer.data());
+                }
+                else{
+                    write(string_view(element));
+                }
+            }
+
+            //Write the elements of [first, last) in [a, b, c] format. The first element is written before the loop, so the loop has no branch
+            //for the separator.
+            template<typename It>
+            void writeList(It first, It last){
+                write('[');
+                if(first!= last){
+                    write(*first);
+                    for(++first; first!= last; ++first){
+                        write(string_view(", "));
+                        write(*first);
+                    }
+                }
+                write(']');
+            }
+    };
+
+    //Print one order of a container, for example writeOrder(cout, container.descending_order())
+    template<typename T>
+    void writeOrder(ostream& os, const OrderView<T>& view){
+        BufferedWriter writer(os);
+        writer.writeList(view.begin(), view.end());
+    }
+
+    //Print the container in insertion order, like operator<<, directly from the storage (without making a snapshot)
+    template<typename T, typename Storage, typename Compare, typename Projection>
+    void writeContainer(ostream& os, const MyContainer<T, Storage, Compare, Projection>& container){
+        BufferedWriter writer(os);
+        writer.writeList(container.getStorage().begin(), container.getStorage().end());
+    }
+} //End of namespace exercise4
@@ -0,0 +1,110 @@
+//vanunuraz@gmail.com
+//This header defines "Generator", a small C++20 coroutine generator (like std::generator of C++23, which the compiler does not have yet).
+//A coroutine that returns Generator<T> gives its elements with co_yield, one at a time, only when the caller asks for the next one. The caller
+//uses it in a range-for loop, and can stop early (break) without computing the rest.
+
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <utility>
+
+namespace exercise4{
+
+    template<typename T>
+    class Generator{
+        public:
+            struct promise_type{
+                const T* current= nullptr; //The element of the last co_yield, it lives in the coroutine until the next resume
+                std::exception_ptr error;
+
+                Generator get_return_object(){
+                    return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+                }
+                std::suspend_always initial_suspend() noexcept{ return {}; } //Lazy: nothing runs before the first element is asked
+                std::suspend_always final_suspend() noexcept{ return {}; }
+                std::suspend_always yield_value(const T& element) noexcept{
+                    current= &element;
+                    return {};
+                }
+                void return_void(){}
+                void unhandled_exception(){
+                    error= std::current_exception(); //Thrown again to the caller from begin() or operator++
+                }
+            };
+
+            //Input iterator over the generated elements, compared with the end sentinel
+            class iterator{
+                private:
+                    std::coroutine_handle<promise_type> handle;
+
+                public:
+                    using iterator_category= std::input_iterator_tag;
+                    using value_type= T;
+                    using difference_type= std::ptrdiff_t;
+
+                    iterator() = default;
+                    explicit iterator(std::coroutine_handle<promise_type> coroutine): handle(coroutine){}
+
+                    const T& operator*() const{
+                        return *handle.promise().current;
+                    }
+                    const T* operator->() const{
+                        return handle.promise().current;
+                    }
+                    iterator& operator++(){
+                        handle.resume();
+                        rethrowIfFailed(handle);
+                        return *this;
+                    }
+                    void operator++(int){
+                        ++(*this);
+                    }
+                    bool operator==(std::default_sentinel_t) const{
+                        return !handle || handle.done();
+                    }
+            };
+
+        private:
+            std::coroutine_handle<promise_type> handle;
+
+            explicit Generator(std::coroutine_handle<promise_type> coroutine): handle(coroutine){}
+
+            static void rethrowIfFailed(std::coroutine_handle<promise_type> coroutine){
+                if(coroutine.done() && coroutine.promise().error){
+                    std::rethrow_exception(coroutine.promise().error);
+                }
+            }
+
+        public:
+            Generator(Generator&& other) noexcept: handle(std::exchange(other.handle, nullptr)){}
+            Generator& operator=(Generator&& other) noexcept{
+                if(this!= &other){
+                    if(handle){
+                        handle.destroy();
+                    }
+                    handle= std::exchange(other.handle, nullptr);
+                }
+                return *this;
+            }
+            Generator(const Generator&) = delete;
+            Generator& operator=(const Generator&) = delete;
+
+            //Destroying the generator destroys the coroutine frame, also when the caller stopped early
+            ~Generator(){
+                if(handle){
+                    handle.destroy();
+                }
+            }
+
+            //Start the coroutine and run it to the first co_yield. Call begin() only once.
+            iterator begin(){
+                handle.resume();
+                rethrowIfFailed(handle);
+                return iterator(handle);
+            }
+            std::default_sentinel_t end() const{
+                return std::default_sentinel;
+            }
+    };
+} //End of namespace exercise4
@@ -0,0 +1,211 @@
+//vanunuraz@gmail.com
+//This header loads elements into a "MyContainer" from a stream or a file, much faster than a loop of std::cin >> x.
+
+//The input is read in large blocks. Numbers (any integer or floating type) are separated by whitespace and parsed with std::from_chars directly from the block,
+//strings are one per line. Each block becomes one batch: the storage reserves room for it and the changes counter is increased once for the
+//batch (addElements), not once for each element. A number or a line cut at the end of a block is carried to the next block.
+
+//For very large files, ingestFileParallel maps the file into memory and splits it into chunks that end at a newline. Each chunk is parsed on a
+//thread of the pool into its own buffer, and the buffers are added in file order with one change of the counter, so Order and ReverseOrder see
+//the same insertion order as a single-threaded load.
+
+#pragma once
+#include <charconv>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MyContainer.hpp"
+#include "ParallelTraversal.hpp"
+
+namespace exercise4{
+
+    namespace ingestion{
+        constexpr size_t DefaultBlockSize= 1<< 20; //1 MiB
+
+        inline bool isSpace(char c){
+            return c== ' ' || c== '\n' || c== '\t' || c== '\r' || c== '\f' || c== '\v';
+        }
+
+        //Parse all the complete elements in [first, last) into out. Returns a pointer to the start of the unfinished tail (a number or a line
+        //that may continue in the next block). With final= true the tail is parsed too, because no more input will come.
+        template<typename T>
+        const char* parseBlock(const char* first, const char* last, vector<T>& out, bool final){
+            if constexpr(std::is_same_v<T, string>){
+                const char* lineStart= first;
+                for(const char* p= first; p!= last; ++p){
+                    if(*p== '\n'){
+                        const char* lineEnd= (p> lineStart && p[-1]== '\r')? p- 1: p; //Also accept Windows line ends
+                        out.emplace_back(lineStart, lineEnd);
+                        lineStart= p+ 1;
+                    }
+                }
+                if(final && lineStart!= last){ //Last line without a newline
+                    out.emplace_back(lineStart, last);
+                    return last;
+                }
+                return lineStart;
+            }
+            else{
+                const char* p= first;
+                while(true){
+                    while(p!= last && isSpace(*p)){
+                        ++p;
+                    }
+                    if(p== last){
+                        return last;
+                    }
+                    const char* tokenEnd= p;
+                    while(tokenEnd!= last && !isSpace(*tokenEnd)){
+                        ++tokenEnd;
+                    }
+                    if(tokenEnd== last && !final){
+                        return p; //The number may continue in the next block
+                    }
+                    T value;
+                    auto [end, error]= std::from_chars(p, tokenEnd, value);
+                    if(error!= std::errc() || end!= tokenEnd){
+                        throw invalid_argument("Invalid number in the input: "+ string(p, tokenEnd));
+                    }
+                    out.push_back(value);
+                    p= tokenEnd;
+                }
+            }
+        }
+
+        //Read-only mapping of a whole file, unmapped in the destructor
+        class FileMapping{
+            private:
+                int fd= -1;
+                void* address= nullptr;
+                size_t length= 0;
+
+            public:
+                explicit FileMapping(const string& path){
+                    fd= open(path.c_str(), O_RDONLY);
+                    if(fd< 0){
+                        throw runtime_error("Can not open "+ path+ " for reading");
+                    }
+                    struct stat info;
+                    if(fstat(fd, &info)!= 0){
+                        close(fd);
+                        throw runtime_error("Can not read the size of "+ path);
+                    }
+                    length= static_cast<size_t>(info.st_size);
+                    if(length> 0){
+                        address= mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                        if(address== MAP_FAILED){
+                            close(fd);
+                            throw runtime_error("Can not map "+ path);
+                        }
+                        madvise(address, length, MADV_SEQUENTIAL); //Only a hint, each thread reads its chunk from start to end
+                    }
+                }
+                FileMapping(const FileMapping&) = delete;
+                FileMapping& operator=(const FileMapping&) = delete;
+                ~FileMapping(){
+                    if(address!= nullptr){
+                        munmap(address, length);
+                    }
+                    close(fd);
+                }
+
+                const char* data() const{
+                    return static_cast<const char*>(address);
+                }
+                size_t size() const{
+                    return length;
+                }
+        };
+
+        //Split [0, size) into about parts chunks, each one ending just after a newline (or at the end of the input)
+        inline vector<size_t> newlineBoundaries(const char* text, size_t size, size_t parts){
+            vector<size_t> bounds{0};
+            for(size_t i= 1; i< parts; ++i){
+                size_t pos= max(bounds.back(), size* i/ parts);
+                while(pos< size && text[pos]!= '\n'){
+                    ++pos;
+                }
+                if(pos>= size){
+                    break;
+                }
+                bounds.push_back(pos+ 1);
+            }
+            bounds.push_back(size);
+            return bounds;
+        }
+    } //End of namespace ingestion
+
+    //Read the whole stream into the container, one batch for each block. Returns the number of elements added.
+    template<typename T, typename Storage, typename Compare, typename Projection>
+    size_t ingest(istream& in, MyContainer<T, Storage, Compare, Projection>& container, size_t blockSize= ingestion::DefaultBlockSize){
+        blockSize= max<size_t>(blockSize, 64);
+        vector<char> buffer(blockSize);
+        vector<T> batch;
+        size_t carried= 0; //Bytes of the unfinished tail at the start of the buffer
+        size_t total= 0;
+        while(true){
+            if(carried== buffer.size()){ //One element longer than the buffer: grow it
+                buffer.resize(buffer.size()* 2);
+            }
+            in.read(buffer.data()+ carried, static_cast<streamsize>(buffer.size()- carried));
+            size_t length= carried+ static_cast<size_t>(in.gcount());
+            bool final= !in;
+            const char* tail= ingestion::parseBlock<T>(buffer.data(), buffer.data()+ length, batch, final);
+            if(!batch.empty()){
+                total+= batch.size();
+                container.addElements(make_move_iterator(batch.begin()), make_move_iterator(batch.end())); //One generation step for the batch
+                batch.clear(); //Keeps the capacity for the next block
+            }
+            if(final){
+                return total;
+            }
+            carried= static_cast<size_t>(buffer.data()+ length- tail);
+            std::copy(tail, static_cast<const char*>(buffer.data()+ length), buffer.data()); //Move the tail to the start
+        }
+    }
+
+    //Read a file into the container
+    template<typename T, typename Storage, typename Compare, typename Projection>
+    size_t ingestFile(const string& path, MyContainer<T, Storage, Compare, Projection>& container, size_t blockSize= ingestion::DefaultBlockSize){
+        ifstream in(path, ios::binary);
+        if(!in){
+            throw runtime_error("Can not open "+ path+ " for reading");
+        }
+        return ingest(in, container, blockSize);
+    }
+
+    //Map the file and parse newline-aligned chunks in parallel on the pool (by default 4 chunks for each worker). The chunk buffers are added in
+    //file order with one change of the counter. Returns the number of elements added.
+    template<typename T, typename Storage, typename Compare, typename Projection>
+    size_t ingestFileParallel(const string& path, MyContainer<T, Storage, Compare, Projection>& container, WorkStealingPool& pool= defaultPool(), size_t chunks= 0){
+        ingestion::FileMapping file(path);
+        if(file.size()== 0){
+            return 0;
+        }
+        vector<size_t> bounds= ingestion::newlineBoundaries(file.data(), file.size(), chunks== 0? pool.size()* 4: chunks);
+        vector<vector<T>> parts(bounds.size()- 1);
+        run_parallel(parts.size(), [&file, &bounds, &parts](size_t i){
+            const char* first= file.data()+ bounds[i];
+            const char* last= file.data()+ bounds[i+ 1];
+            //Saves the first few reallocations. Strings are one per line, so the newlines give the exact count (a guess from the bytes would reserve
+            //a 32-byte string for every few bytes of the file); for numbers one number in 8 bytes is a rough guess
+            if constexpr(std::is_same_v<T, string>){
+                parts[i].reserve(static_cast<size_t>(std::count(first, last, '\n'))+ 1);
+            }
+            else{
+                parts[i].reserve(static_cast<size_t>(last- first)/ 8);
+            }
+            ingestion::parseBlock<T>(first, last, parts[i], true);
+        }, pool);
+        size_t total= 0;
+        for(const auto& part: parts){
+            total+= part.size();
+        }
+        container.addBatches(std::move(parts));
+        return total;
+    }
+} //End of namespace exercise4
@@ -0,0 +1,252 @@
+//vanunuraz@gmail.com
+//This header makes small containers work without the heap.
+//Use SmallContainer<int> (MyContainer<int, InlineVector<int, 16>>) and give it an InlineArena for the snapshots.
+
+//"InlineVector" keeps up to N elements inside the object itself and moves them to the heap only when the N+1 element is added, after that it
+//grows like vector. "InlineArena" is a memory resource with a fixed buffer inside the object: the snapshots and their order buffers are allocated
+//from the buffer one after the other, and when everything is freed the arena starts again from the beginning. Allocations that do not fit go to
+//the upstream resource. With both of them, a container of a few elements and its iterators allocate nothing. Like unsynchronized_pool_resource,
+//an arena is for one thread.
+
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <memory_resource>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    template<typename T, size_t N= 16>
+    class InlineVector{
+        static_assert(N> 0, "InlineVector needs room for at least one element");
+
+        private:
+            alignas(T) unsigned char local[N* sizeof(T)]; //Raw memory for the first N elements, they are constructed in place
+            T* items= inlineItems(); //The local buffer, or a heap block after it grew
+            size_t count= 0;
+            size_t capacityCount= N;
+
+            T* inlineItems(){
+                return reinterpret_cast<T*>(local);
+            }
+            bool isInline() const{
+                return items== reinterpret_cast<const T*>(local);
+            }
+
+            void freeHeap(){
+                if(!isInline()){
+                    allocator<T>().deallocate(items, capacityCount);
+                }
+            }
+
+            //Move the elements to a new heap block with room for capacity elements
+            void grow(size_t capacity){
+                T* block= allocator<T>().allocate(capacity);
+                uninitialized_move(items, items+ count, block);
+                destroy(items, items+ count);
+                freeHeap();
+                items= block;
+                capacityCount= capacity;
+            }
+
+            //Take the elements of other: a heap block is taken as is, inline elements are moved one by one
+            void takeFrom(InlineVector& other){
+                if(other.isInline()){
+                    uninitialized_move(other.items, other.items+ other.count, items);
+                    count= other.count;
+                    other.clear();
+                }
+                else{
+                    items= std::exchange(other.items, other.inlineItems());
+                    count= std::exchange(other.count, 0);
+                    capacityCount= std::exchange(other.capacityCount, N);
+                }
+            }
+
+        public:
+            using value_type= T;
+            using iterator= T*;
+            using const_iterator= const T*;
+
+            InlineVector() = default;
+            InlineVector(initializer_list<T> list){
+                insert(end(), list.begin(), list.end());
+            }
+            template<typename InputIt>
+            InlineVector(InputIt first, InputIt last){
+                insert(end(), first, last);
+            }
+
+            InlineVector(const InlineVector& other){
+                reserve(other.count);
+                uninitialized_copy(other.begin(), other.end(), items);
+                count= other.count;
+            }
+            InlineVector& operator=(const InlineVector& other){
+                if(this!= &other){
+                    clear();
+                    reserve(other.count);
+                    uninitialized_copy(other.begin(), other.end(), items);
+                    count= other.count;
+                }
+                return *this;
+            }
+
+            InlineVector(InlineVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>){
+                takeFrom(other);
+            }
+            InlineVector& operator=(InlineVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>){
+                if(this!= &other){
+                    clear();
+                    freeHeap();
+                    items= inlineItems();
+                    capacityCount= N;
+                    takeFrom(other);
+                }
+                return *this;
+            }
+
+            ~InlineVector(){
+                clear();
+                freeHeap();
+            }
+
+            size_t size() const{
+                return count;
+            }
+            bool empty() const{
+                return count== 0;
+            }
+            size_t capacity() const{
+                return capacityCount;
+            }
+            //True while the elements are still inside the object
+            bool isLocal() const{
+                return isInline();
+            }
+
+            T* data(){ return items; }
+            const T* data() const{ return items; }
+            T* begin(){ return items; }
+            T* end(){ return items+ count; }
+            const T* begin() const{ return items; }
+            const T* end() const{ return items+ count; }
+            T& operator[](size_t i){ return items[i]; }
+            const T& operator[](size_t i) const{ return items[i]; }
+
+            void reserve(size_t capacity){
+                if(capacity> capacityCount){
+                    grow(capacity);
+                }
+            }
+
+            void push_back(const T& element){
+                if(count== capacityCount){
+                    T copy(element); //element may be one of the elements that grow moves
+                    grow(capacityCount* 2);
+                    new(items+ count) T(std::move(copy));
+                }
+                else{
+                    new(items+ count) T(element);
+                }
+                ++count;
+            }
+            void push_back(T&& element){
+                if(count== capacityCount){
+                    T moved(std::move(element));
+                    grow(capacityCount* 2);
+                    new(items+ count) T(std::move(moved));
+                }
+                else{
+                    new(items+ count) T(std::move(element));
+                }
+                ++count;
+            }
+
+            //Insert [first, last) before position: the new elements are added at the end and rotated into place
+            template<typename InputIt>
+            T* insert(const T* position, InputIt first, InputIt last){
+                size_t at= static_cast<size_t>(position- items);
+                size_t before= count;
+                if constexpr(std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>){
+                    size_t added= static_cast<size_t>(std::distance(first, last));
+                    if(count+ added> capacityCount){
+                        grow(max(capacityCount* 2, count+ added));
+                    }
+                }
+                for(; first!= last; ++first){
+                    push_back(*first);
+                }
+                std::rotate(items+ at, items+ before, items+ count);
+                return items+ at;
+            }
+
+            //Erase [first, last) and move the rest to the left
+            T* erase(const T* first, const T* last){
+                T* from= items+ (first- items);
+                T* newEnd= std::move(items+ (last- items), end(), from);
+                destroy(newEnd, end());
+                count= static_cast<size_t>(newEnd- items);
+                return from;
+            }
+
+            void clear(){
+                destroy(items, items+ count);
+                count= 0;
+            }
+    };
+
+    template<size_t Bytes>
+    class InlineArena: public pmr::memory_resource{
+        private:
+            alignas(std::max_align_t) unsigned char buffer[Bytes];
+            size_t used= 0; //Bytes given from the start of the buffer
+            size_t live= 0; //Blocks of the buffer that are not freed yet
+            pmr::memory_resource* upstream;
+
+            bool owns(const void* p) const{
+                return p>= static_cast<const void*>(buffer) && p< static_cast<const void*>(buffer+ Bytes);
+            }
+
+            //The address itself is aligned (not only the offset), so an alignment above max_align_t is right too
+            void* do_allocate(size_t bytes, size_t alignment) override{
+                void* start= buffer+ used;
+                size_t space= Bytes- used;
+                if(std::align(alignment, bytes, start, space)!= nullptr){
+                    used= static_cast<size_t>(static_cast<unsigned char*>(start)- buffer)+ bytes;
+                    ++live;
+                    return start;
+                }
+                return upstream->allocate(bytes, alignment); //Too big for what is left
+            }
+
+            void do_deallocate(void* p, size_t bytes, size_t alignment) override{
+                if(owns(p)){
+                    if(--live== 0){
+                        used= 0; //Everything was freed, start again from the beginning
+                    }
+                    return;
+                }
+                upstream->deallocate(p, bytes, alignment);
+            }
+
+            bool do_is_equal(const pmr::memory_resource& other) const noexcept override{
+                return this== &other;
+            }
+
+        public:
+            explicit InlineArena(pmr::memory_resource* next= pmr::get_default_resource()): upstream(next){}
+            InlineArena(const InlineArena&) = delete;
+            InlineArena& operator=(const InlineArena&) = delete;
+
+            //Bytes of the buffer in use now
+            size_t usedBytes() const{
+                return used;
+            }
+    };
+
+    //Container that keeps up to N elements inside the object
+    template<typename T=int, size_t N= 16>
+    using SmallContainer= MyContainer<T, InlineVector<T, N>>;
+} //End of namespace exercise4
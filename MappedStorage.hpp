@@ -0,0 +1,238 @@
+//vanunuraz@gmail.com
+//This header defines "MappedVector", a storage for MyContainer that keeps the elements in a memory-mapped file instead of the heap.
+//Use it as the second template argument: MyContainer<int, MappedVector<int>> c(MappedVector<int>("data.bin"));
+
+//The file starts with a small header (magic, element size, count) and then the elements as a raw array. Appends write into the mapping and grow
+//the file (doubling) when it is full. Opening an existing file maps it and the container is ready at once, without reading or parsing anything.
+//Only for types that can be copied as raw bytes (int, double), because a string holds a pointer to the heap.
+
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    template<typename T>
+    class MappedVector{
+        static_assert(std::is_trivially_copyable_v<T>, "MappedVector supports only types that can be copied as raw bytes");
+
+        private:
+            //Header at the start of the file. Its size is a multiple of 8, so the elements after it are aligned for double.
+            struct Header{
+                char magic[8];
+                uint64_t elementSize;
+                uint64_t count;
+                uint64_t reserved;
+            };
+            static constexpr char Magic[8]= {'M','Y','C','M','A','P','1','\0'};
+            static constexpr size_t MinCapacity= 1024;
+
+            int fd= -1;
+            void* mapping= nullptr;
+            size_t mappedBytes= 0;
+            size_t capacityCount= 0; //Number of elements that fit in the mapped file
+
+            Header* header() const{
+                return static_cast<Header*>(mapping);
+            }
+            T* elements() const{
+                return reinterpret_cast<T*>(static_cast<char*>(mapping)+ sizeof(Header));
+            }
+
+            [[noreturn]] static void fail(const string& what){
+                throw runtime_error("MappedVector: "+ what+ ": "+ strerror(errno));
+            }
+
+            //Map bytes of the file, replacing the old mapping
+            void mapFile(size_t bytes){
+                if(mapping!= nullptr){
+                    munmap(mapping, mappedBytes);
+                    mapping= nullptr;
+                }
+                void* address= mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if(address== MAP_FAILED){
+                    fail("mmap");
+                }
+                mapping= address;
+                mappedBytes= bytes;
+                capacityCount= (bytes- sizeof(Header))/ sizeof(T);
+            }
+
+            void release(){
+                if(mapping!= nullptr){
+                    munmap(mapping, mappedBytes);
+                }
+                if(fd>= 0){
+                    close(fd);
+                }
+                fd= -1;
+                mapping= nullptr;
+                mappedBytes= 0;
+                capacityCount= 0;
+            }
+
+            //Map an open file: a new (empty) file gets the header and room for the first elements, an existing one is checked
+            void initialize(const string& path){
+                struct stat info;
+                if(fstat(fd, &info)!= 0){
+                    fail("fstat "+ path);
+                }
+                size_t bytes= static_cast<size_t>(info.st_size);
+                if(bytes== 0){ //New file: write the header and room for the first elements
+                    bytes= sizeof(Header)+ MinCapacity* sizeof(T);
+                    if(ftruncate(fd, bytes)!= 0){
+                        fail("ftruncate "+ path);
+                    }
+                    mapFile(bytes);
+                    memcpy(header()->magic, Magic, sizeof(Magic));
+                    header()->elementSize= sizeof(T);
+                    header()->count= 0;
+                    header()->reserved= 0;
+                    return;
+                }
+                if(bytes< sizeof(Header)){
+                    throw runtime_error("MappedVector: "+ path+ " is too small to be a mapped container");
+                }
+                mapFile(bytes);
+                if(memcmp(header()->magic, Magic, sizeof(Magic))!= 0 || header()->elementSize!= sizeof(T) || header()->count> capacityCount){
+                    throw runtime_error("MappedVector: "+ path+ " is not a mapped container of this element type");
+                }
+            }
+
+        public:
+            using value_type= T;
+            using iterator= T*;
+            using const_iterator= const T*;
+
+            //Open the file, or create it if it does not exist. Throw if the file is not a MappedVector of the same element size. The destructor
+            //does not run when the constructor throws, so every error after open closes the file (and the mapping) here.
+            explicit MappedVector(const string& path){
+                fd= open(path.c_str(), O_RDWR | O_CREAT, 0644);
+                if(fd< 0){
+                    fail("open "+ path);
+                }
+                try{
+                    initialize(path);
+                }
+                catch(...){
+                    release();
+                    throw;
+                }
+            }
+
+            MappedVector(const MappedVector&) = delete; //One owner for the mapping
+            MappedVector& operator=(const MappedVector&) = delete;
+
+            MappedVector(MappedVector&& other) noexcept:
+                fd(std::exchange(other.fd, -1)), mapping(std::exchange(other.mapping, nullptr)),
+                mappedBytes(std::exchange(other.mappedBytes, 0)), capacityCount(std::exchange(other.capacityCount, 0)){}
+            MappedVector& operator=(MappedVector&& other) noexcept{
+                if(this!= &other){
+                    release();
+                    fd= std::exchange(other.fd, -1);
+                    mapping= std::exchange(other.mapping, nullptr);
+                    mappedBytes= std::exchange(other.mappedBytes, 0);
+                    capacityCount= std::exchange(other.capacityCount, 0);
+                }
+                return *this;
+            }
+
+            ~MappedVector(){
+                release(); //The elements are already in the file (shared mapping), munmap does not lose them
+            }
+
+            size_t size() const{
+                return mapping== nullptr? 0: header()->count;
+            }
+            bool empty() const{
+                return size()== 0;
+            }
+            size_t capacity() const{
+                return capacityCount;
+            }
+
+            T* data(){ return elements(); }
+            const T* data() const{ return elements(); }
+            T* begin(){ return elements(); }
+            T* end(){ return elements()+ size(); }
+            const T* begin() const{ return elements(); }
+            const T* end() const{ return elements()+ size(); }
+            T& operator[](size_t i){ return elements()[i]; }
+            const T& operator[](size_t i) const{ return elements()[i]; }
+
+            //Grow the file and the mapping so count elements fit. The elements move to a new address, like in vector.
+            void reserve(size_t count){
+                if(count<= capacityCount){
+                    return;
+                }
+                size_t bytes= sizeof(Header)+ count* sizeof(T);
+                if(ftruncate(fd, bytes)!= 0){
+                    fail("ftruncate");
+                }
+                mapFile(bytes);
+            }
+
+            void push_back(const T& element){
+                size_t count= size();
+                if(count== capacityCount){
+                    T copy= element; //element may be inside the mapping that reserve replaces
+                    reserve(max(capacityCount* 2, MinCapacity));
+                    elements()[count]= copy;
+                }
+                else{
+                    elements()[count]= element;
+                }
+                header()->count= count+ 1;
+            }
+
+            //Insert a range, only at the end (the container only appends)
+            template<typename InputIt>
+            T* insert(const T* position, InputIt first, InputIt last){
+                if(position!= end()){
+                    throw invalid_argument("MappedVector supports insert only at the end");
+                }
+                size_t at= size();
+                if constexpr(std::is_base_of_v<std::forward_iterator_tag, typename std::iterator_traits<InputIt>::iterator_category>){
+                    size_t added= static_cast<size_t>(std::distance(first, last));
+                    if(at+ added> capacityCount){
+                        reserve(max(capacityCount* 2, at+ added));
+                    }
+                    std::copy(first, last, elements()+ at);
+                    header()->count= at+ added;
+                }
+                else{
+                    for(; first!= last; ++first){
+                        push_back(*first);
+                    }
+                }
+                return elements()+ at;
+            }
+
+            //Erase [first, last) and move the rest to the left
+            T* erase(const T* first, const T* last){
+                T* from= elements()+ (first- elements());
+                size_t removed= static_cast<size_t>(last- first);
+                std::copy(last, static_cast<const T*>(end()), from);
+                header()->count= size()- removed;
+                return from;
+            }
+
+            void clear(){
+                header()->count= 0;
+            }
+
+            //Write the dirty pages to the disk now (otherwise the kernel writes them later)
+            void sync(){
+                if(mapping!= nullptr && msync(mapping, mappedBytes, MS_SYNC)!= 0){
+                    fail("msync");
+                }
+            }
+    };
+} //End of namespace exercise4
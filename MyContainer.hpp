@@ -1,104 +1,708 @@
 //vanunuraz@gmail.com
-//This header defines a templated container class "MyContainer" that accepts only int, double, or string types. This container supports various operations
-//like adding/removing elements. In this container also implements iterators that allow traversal of the container in different orders.
+//This header defines a templated container class "MyContainer" that accepts any totally ordered type (int, double, string, int64_t, float, ...).
+//This container supports various operations like adding/removing elements. In this container also implements iterators that allow traversal of
+//the container in different orders.
 
-//The base iterator class "IteratorBase" provides common functionality for all iterators, including dereferencing, incrementing, and comparison operators. 
-//Six different iterator types at "MyContainer" inherits from a base iterator class, each implementing a specific order of traversal: ascending, descending, reverse, order, sideCross, and middleOut.
+//The iterator template "OrderIterator" provides the functionality of all iterators, including dereferencing, incrementing, and comparison operators.
+//The six iterator types of "MyContainer" are OrderIterator with a different order policy: ascending, descending, reverse, order, sideCross, and middleOut.
 //I decided implement a mechanism to check if the container has changed since the iterator was created, throwing an exception if it has.
+//The iterators do not copy the data: they share an immutable "OrderSnapshot" of the container, made once for each generation.
 
 #pragma once
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <memory_resource>
+#include <concepts>
+#include <iterator>
+#include <span>
+#include <bit>
+#include <functional>
+#include <optional>
+#include "Generator.hpp"
+#include "SortKernels.hpp"
 using namespace std;
 
 namespace exercise4{
 
-//IteratorBase: Shared base class for all iterators by template. Holds a local copy of the data, tracks the current index, and checks if the container has changed.
-//Ensures safety when accessing data by throwing an exception if the container was modified.
+//Index maps of the orders that are built from the sorted buffer: for position pos (0..size-1) of the order, return the index in the sorted
+//buffer. They give the same sequences as the side cross and middle out loops, but for one position at a time.
+    constexpr size_t sideCrossIndex(size_t pos, size_t size){
+        return pos%2== 0? pos/ 2: size- 1- pos/ 2; //Even positions from the left, odd positions from the right
+    }
+
+    constexpr size_t middleOutIndex(size_t pos, size_t size){
+        if(size%2== 1){ //Odd: middle, then left and right in turn
+            size_t mid= size/ 2;
+            return pos== 0? mid: (pos%2== 1? mid- (pos+ 1)/ 2: mid+ pos/ 2);
+        }
+        //Even: left of center, then right and left in turn
+        size_t midLeft= size/ 2- 1;
+        return pos== 0? midLeft: (pos%2== 1? size/ 2+ (pos- 1)/ 2: midLeft- pos/ 2);
+    }
+
+//Hash of a range that does not depend on the order of the elements: the sum of a mixed hash of each element. Two ranges with the same
+//elements in any order have the same hash, so it checks in O(n) that a sorted buffer from outside (a file) holds the elements of a container.
+//Numbers are hashed by their bits, so 0.0 and -0.0 differ. Returns nullopt for types without std::hash.
+    template<typename Range>
+    optional<uint64_t> multisetHash(const Range& elements){
+        using T= ranges::range_value_t<Range>;
+        auto mix= [](uint64_t x){ //Finalizer of splitmix64
+            x= (x^ (x>> 30))* 0xbf58476d1ce4e5b9ULL;
+            x= (x^ (x>> 27))* 0x94d049bb133111ebULL;
+            return x^ (x>> 31);
+        };
+        uint64_t sum= 0;
+        if constexpr(is_arithmetic_v<T> && (sizeof(T)== 1 || sizeof(T)== 2 || sizeof(T)== 4 || sizeof(T)== 8)){
+            using Bits= conditional_t<sizeof(T)== 1, uint8_t, conditional_t<sizeof(T)== 2, uint16_t, conditional_t<sizeof(T)== 4, uint32_t, uint64_t>>>;
+            for(const T& element: elements){
+                sum+= mix(bit_cast<Bits>(element));
+            }
+        }
+        else if constexpr(requires(const T& element){ { hash<T>{}(element) }-> convertible_to<size_t>; }){
+            for(const T& element: elements){
+                sum+= mix(hash<T>{}(element));
+            }
+        }
+        else{
+            return nullopt;
+        }
+        return sum;
+    }
+
+//The six orders of the container, to choose an order at run time (for example copy_order_into)
+    enum class OrderKind{Ascending, Descending, SideCross, MiddleOut, Reverse, Insertion};
+
+//OrderSnapshot: immutable copy of the container data at one generation, shared by all the iterators created at that generation. The sorted
+//orders are computed lazily, once for each snapshot, the first time an iterator asks for them. Writers never change a published snapshot, they
+//publish a new one, so a reader never sees a torn state. A snapshot is deleted when the container and the last iterator drop it.
+//All the buffers of a snapshot allocate from one std::pmr::memory_resource (the one of the container), for example an arena.
+    template<typename T>
+    class OrderSnapshot{
+        public:
+            using Buffer= pmr::vector<T>;
+            using Sorter= void (*)(Buffer&); //Sorts a buffer in the ascending order of the container (its comparator and projection)
+
+        private:
+            enum Kind{ Ascending, Descending, Reverse, SideCross, MiddleOut, KindCount };
+
+            static void naturalSort(Buffer& buffer){
+                sortElements(buffer.begin(), buffer.end(), buffer.get_allocator().resource()); //A sorting network for a few numbers, radix sort for many, std::sort otherwise
+            }
+
+            Buffer elements; //Elements in insertion order
+            uint64_t generation; //Changes counter of the container when the snapshot was made
+            mutable array<Buffer, KindCount> orders; //Lazy order buffers, all on the memory resource of the snapshot
+            mutable array<atomic<bool>, KindCount> built{}; //True after the order buffer was computed
+            mutable mutex buildLock; //Only one thread computes an order, the others wait and then share it
+            Sorter sorter; //Called once, the first time the ascending order is needed
+
+            //Empty order buffers that allocate from resource. Returned as a prvalue, so each buffer is made in place with its resource.
+            static array<Buffer, KindCount> makeOrders(pmr::memory_resource* resource){
+                return {Buffer(resource), Buffer(resource), Buffer(resource), Buffer(resource), Buffer(resource)};
+            }
+
+            //Return the order buffer, filling it with build(buffer) on first use (double checked with the atomic flag)
+            template<typename Build>
+            const Buffer& lazy(Kind kind, Build build) const{
+                if(!built[kind].load(memory_order_acquire)){
+                    lock_guard<mutex> guard(buildLock);
+                    if(!built[kind].load(memory_order_relaxed)){
+                        build(orders[kind]);
+                        built[kind].store(true, memory_order_release);
+                    }
+                }
+                return orders[kind];
+            }
+
+            //Switch between smallest and largest remaining elements of the sorted buffer
+            static void buildSideCross(const Buffer& sorted, Buffer& result){
+                result.clear();
+                result.reserve(sorted.size());
+                //point to the beginning and end of the container
+                int left= 0;
+                int right= sorted.size()- 1;
+                while(left <= right){ //While the left index is less than or equal to the right index
+                    result.push_back(sorted[left++]); //Add the leftmost element
+                    if(left <= right){
+                        result.push_back(sorted[right--]);//Add the rightmost element
+                    }
+                }
+            }
+
+            //To handle with memory leak, I use size_t because .size() returns size_t= unsigned long and its problem to compare with int.
+            static void buildMiddleOut(const Buffer& sorted, Buffer& result){
+                result.clear();
+                size_t size= sorted.size(); //Get the size of the sorted vector
+                //If the size is 0, there is nothing to add
+                if(size== 0){
+                    return;
+                }
+                result.reserve(size);
+                //If the size is odd, start from the middle and alternate between left and right elements
+                if(size%2== 1){
+                    size_t mid= size/ 2;
+                    result.push_back(sorted[mid]);
+                    size_t left= mid- 1;
+                    size_t right= mid+ 1;
+                    bool leftTurn= true;
+                    //Alternating between left and right elements until all elements are added
+                    while(left< size || right< size){
+                        //Left
+                        if(leftTurn&& left< size){
+                            result.push_back(sorted[left--]);
+                        }
+                        //Right
+                        if(!leftTurn && right< size){
+                            result.push_back(sorted[right++]);
+                        }
+                        leftTurn= !leftTurn; //Switch between left and right
+                    }
+                }
+                //If the size is even, start from the left of center and alternate between left and right elements
+                else{
+                    //Mid_left is the left middle element and mid_right is the right middle element
+                    size_t mid_left= size/ 2-1;
+                    size_t mid_right= size/ 2;
+                    result.push_back(sorted[mid_left]);
+
+                    size_t left= (mid_left> 0)? mid_left- 1: size; //If mid_left is 0, set left to size to avoid out of range
+                    size_t right= mid_right; //Start from the right middle element at the right side
+                    bool rightTurn= true;
+                    //Start from the right of center and alternate between left and right elements until all elements are added
+                    while(left< size || right< size){
+                        if(rightTurn && right< size){
+                            result.push_back(sorted[right++]);
+                        }
+                        else if(!rightTurn && left< size){
+                            result.push_back(sorted[left--]);
+                        }
+                        rightTurn= !rightTurn; //Switch between left and rights
+                    }
+                }
+            }
+
+        public:
+            //Copy of the elements [first, last) at generation changes, with all the buffers on resource
+            template<typename InputIt>
+            OrderSnapshot(InputIt first, InputIt last, uint64_t changes, pmr::memory_resource* resource= pmr::get_default_resource(),
+                Sorter sortBy= &naturalSort):
+                elements(first, last, resource), generation(changes), orders(makeOrders(resource)), sorter(sortBy){}
+
+            //Snapshot with the sorted buffer already known (for example restored from a file), so the ascending order is not sorted again.
+            //sorted should use the same resource, then it is moved without a copy.
+            template<typename InputIt>
+            OrderSnapshot(InputIt first, InputIt last, uint64_t changes, pmr::memory_resource* resource, Buffer sorted, Sorter sortBy= &naturalSort):
+                OrderSnapshot(first, last, changes, resource, sortBy){
+                orders[Ascending]= std::move(sorted);
+                built[Ascending].store(true, memory_order_release);
+            }
+
+            pmr::memory_resource* getResource() const{
+                return elements.get_allocator().resource();
+            }
+
+            //Use this snapshot again for another generation: the buffers keep their capacity, so the next orders are built without allocating.
+            //Only for a snapshot that nobody else holds (the container checks it before).
+            template<typename InputIt>
+            void reuse(InputIt first, InputIt last, uint64_t changes){
+                elements.assign(first, last);
+                generation= changes;
+                for(auto& flag: built){
+                    flag.store(false, memory_order_relaxed);
+                }
+            }
+
+            //True if the sorted buffer was already computed (or restored)
+            bool hasAscending() const{
+                return built[Ascending].load(memory_order_acquire);
+            }
+
+            uint64_t getGeneration() const{
+                return generation;
+            }
+
+            const Buffer& insertion() const{
+                return elements;
+            }
+
+            //The buffer of an order chosen at run time, made on first use like the accessors below
+            const Buffer& materialized(OrderKind kind) const{
+                switch(kind){
+                    case OrderKind::Ascending: return ascending();
+                    case OrderKind::Descending: return descending();
+                    case OrderKind::SideCross: return sideCross();
+                    case OrderKind::MiddleOut: return middleOut();
+                    case OrderKind::Reverse: return reverse();
+                    default: return insertion();
+                }
+            }
+
+            const Buffer& ascending() const{
+                return lazy(Ascending, [this](Buffer& sorted){
+                    sorted.assign(elements.begin(), elements.end());
+                    sorter(sorted);
+                });
+            }
+
+            //The cached sorted buffer read backwards, so it is not sorted a second time and it is the same sequence as the DescendingOrder iterator
+            const Buffer& descending() const{
+                const Buffer& sorted= ascending();
+                return lazy(Descending, [&sorted](Buffer& result){
+                    result.assign(sorted.rbegin(), sorted.rend());
+                });
+            }
+
+            const Buffer& reverse() const{
+                return lazy(Reverse, [this](Buffer& reversed){
+                    reversed.assign(elements.rbegin(), elements.rend()); //Reverse the order of elements
+                });
+            }
+
+            //The side cross and middle out orders are built from the sorted buffer, so it is computed first (outside the build lock)
+            const Buffer& sideCross() const{
+                const Buffer& sorted= ascending();
+                return lazy(SideCross, [&sorted](Buffer& result){ buildSideCross(sorted, result); });
+            }
+
+            const Buffer& middleOut() const{
+                const Buffer& sorted= ascending();
+                return lazy(MiddleOut, [&sorted](Buffer& result){ buildMiddleOut(sorted, result); });
+            }
+    };
+
+    //Type of the order buffers that iterators and views read
     template<typename T>
-    class IteratorBase{
-        protected:
-            vector<T> data; //The data in vector at the time of iterator creation
-            size_t index; //Current index in the iteration
-            const int* currentChanges; //Pointer to the change counter in MyContainer
-            int changesAtCreateIter; //The value of the change counter when this iterator was created
-
-            //Check if container has changed since iterator was created
+    using OrderBuffer= typename OrderSnapshot<T>::Buffer;
+
+//Order policies: each order is a small struct with two static functions. source(snapshot) gives the buffer the order reads (the insertion
+//order or the sorted buffer) and index(pos, size) maps position pos of the order to an index in that buffer. Descending, reverse, side cross
+//and middle out are index maps, so the iterators never materialize them. A user-defined order is one more struct with the same two functions.
+    namespace orders{
+        struct Ascending{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.ascending(); }
+            static constexpr size_t index(size_t pos, size_t){ return pos; }
+        };
+        struct Descending{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.ascending(); }
+            static constexpr size_t index(size_t pos, size_t size){ return size- 1- pos; } //The sorted buffer from the end
+        };
+        struct Reverse{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.insertion(); }
+            static constexpr size_t index(size_t pos, size_t size){ return size- 1- pos; }
+        };
+        struct Insertion{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.insertion(); }
+            static constexpr size_t index(size_t pos, size_t){ return pos; }
+        };
+        struct SideCross{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.ascending(); }
+            static constexpr size_t index(size_t pos, size_t size){ return sideCrossIndex(pos, size); }
+        };
+        struct MiddleOut{
+            template<typename T>
+            static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.ascending(); }
+            static constexpr size_t index(size_t pos, size_t size){ return middleOutIndex(pos, size); }
+        };
+
+        //Custom order from a functor: map(pos, size) gives the index of position pos, in the sorted buffer if sorted is true or in the insertion
+        //order if not. The functor is stored in each iterator, so it can hold state (a stride, a number of bits). It is kept in an optional that
+        //is assigned by emplace, so the iterator stays default constructible and copy assignable (a random access iterator) also when the
+        //functor is not, like a lambda with captures.
+        template<typename Map>
+        struct Mapped{
+            optional<Map> map;
+            bool sorted= false;
+
+            Mapped()= default;
+            Mapped(Map map, bool sorted): map(in_place, std::move(map)), sorted(sorted){}
+            Mapped(const Mapped&)= default;
+            Mapped(Mapped&&)= default;
+            Mapped& operator=(const Mapped& other){
+                if(this!= &other){
+                    assign(other.map);
+                    sorted= other.sorted;
+                }
+                return *this;
+            }
+            Mapped& operator=(Mapped&& other){
+                if(this!= &other){
+                    assign(std::move(other.map));
+                    sorted= other.sorted;
+                }
+                return *this;
+            }
+
+            template<typename T>
+            const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot) const{
+                return sorted? snapshot.ascending(): snapshot.insertion();
+            }
+            size_t index(size_t pos, size_t size) const{
+                size_t result= static_cast<size_t>((*map)(pos, size));
+                if(result>= size){
+                    throw out_of_range("The custom order maps a position outside the container");
+                }
+                return result;
+            }
+
+            private:
+                template<typename Other>
+                void assign(Other&& other){
+                    if(other){
+                        map.emplace(*std::forward<Other>(other));
+                    }
+                    else{
+                        map.reset();
+                    }
+                }
+        };
+    } //End of namespace orders
+
+//OrderIterator: the one iterator template of all the orders, the order is the compile-time Policy, so the index map is inlined. Holds a shared
+//pointer to the snapshot of the data, tracks the current position, and checks if the container has changed. Creating an iterator is O(1): it does
+//not copy the data, it shares the snapshot of its generation. It is a random access iterator: the element of any position is computed from the
+//index map, so it can jump, go back and be used with std algorithms.
+//Ensures safety when accessing data by throwing an exception if the container was modified.
+    template<typename T, typename Policy>
+    class OrderIterator{
+        private:
+            shared_ptr<const OrderSnapshot<T>> snapshot; //Keeps the shared data alive while the iterator exists
+            const OrderBuffer<T>* data= nullptr; //The buffer inside the snapshot that the order reads
+            size_t index= 0; //Current position in the order
+            const atomic<uint64_t>* currentChanges= nullptr; //Pointer to the change counter (generation) in MyContainer
+            uint64_t changesAtCreateIter= 0; //The value of the change counter when this iterator was created
+            [[no_unique_address]] Policy policy; //Empty for the built-in orders, holds the functor of a custom order
+
+            //Check if container has changed since iterator was created. The counter is atomic, so a reader thread can check it while a writer
+            //thread modifies the container without a data race. A value-initialized iterator has no container, so there is nothing to check.
             void compareChanges() const{
-                if(*currentChanges!= changesAtCreateIter){
+                if(currentChanges!= nullptr && currentChanges->load(memory_order_acquire)!= changesAtCreateIter){
                     throw runtime_error("Iterator invalid because the container was modified");
                 }
             }
 
+            //Set all the fields from a snapshot, used by the constructors and refresh
+            void bind(shared_ptr<const OrderSnapshot<T>> shared, const atomic<uint64_t>* counter, bool end){
+                snapshot= std::move(shared);
+                data= &policy.source(*snapshot); //Sorts this snapshot if the order needs the sorted buffer and it was not made yet
+                index= end? data->size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
+                //Set the current changes pointer and the changes at the time of the snapshot for comparing later
+                currentChanges= counter;
+                changesAtCreateIter= snapshot->getGeneration();
+            }
+
+            //Element at position pos. Throws out_of_range outside the order, like vector::at.
+            const T& element(size_t pos) const{
+                if(pos>= data->size()){
+                    throw out_of_range("Iterator out of the range of the container");
+                }
+                return (*data)[policy.index(pos, data->size())];
+            }
+
         public:
+            using iterator_category= random_access_iterator_tag;
+            using value_type= T;
+            using difference_type= ptrdiff_t;
+            using pointer= const T*;
+            using reference= const T&;
+
+            OrderIterator() = default;
+
+            //From the container (uses its current snapshot)
+            template<typename Container> requires requires(const Container& container){ container.snapshot(); container.getChangesPointer(); }
+            OrderIterator(const Container& container, bool end= false, Policy order= Policy()):
+                OrderIterator(container.snapshot(), container.getChangesPointer(), end, std::move(order)){}
+
+            //From a snapshot that was taken before, used by the thread-safe containers to create iterators without a lock
+            OrderIterator(shared_ptr<const OrderSnapshot<T>> shared, const atomic<uint64_t>* counter, bool end= false, Policy order= Policy()):
+                policy(std::move(order)){
+                bind(std::move(shared), counter, end);
+            }
+
+            //Rebind the iterator to the current generation of the container, at the beginning (or the end). If this iterator held the last reference
+            //to its old snapshot, the container reuses that snapshot with its buffers, so a polling loop does not allocate for each refresh.
+            template<typename Container>
+            void refresh(const Container& container, bool end= false){
+                data= nullptr;
+                container.recycle(std::move(snapshot));
+                bind(container.snapshot(), container.getChangesPointer(), end);
+            }
+
             //Before using each action, call compareChanges to ensure the iterator is still valid
 
             //This operator returns reference to the current element in the iteration.
             const T& operator*() const{
                 compareChanges();
-                return data.at(index); //Operator for accessing the current element at index. at return error if index is out of the range.
+                return element(index);
             }
 
             //This operator returns a pointer to the current element in the iteration that allows access to its members.
             const T* operator->() const{
                 compareChanges();
-                return &data.at(index); //Pointer access operator for the current element
+                return &element(index); //Pointer access operator for the current element
+            }
+
+            //Element n positions after the current one
+            const T& operator[](difference_type n) const{
+                compareChanges();
+                return element(index+ n);
             }
 
             //Pre-increment
-            IteratorBase& operator++(){
+            OrderIterator& operator++(){
                 compareChanges();
                 ++index; 
                 return *this;
             }
 
-            //Post-increment
-            IteratorBase operator++(int){
+            //Post-increment. Returns the same iterator type, so nothing is sliced; only the shared pointer is copied, not the data.
+            OrderIterator operator++(int){
+                compareChanges();
+                OrderIterator tmp= *this;
+                ++index;
+                return tmp;
+            }
+
+            OrderIterator& operator--(){
+                compareChanges();
+                --index;
+                return *this;
+            }
+            OrderIterator operator--(int){
                 compareChanges();
-                IteratorBase tmp = *this; //Create a copy of the current state. The copy is automatically by compiler.
-                ++(*this);
+                OrderIterator tmp= *this;
+                --index;
                 return tmp;
             }
 
+            OrderIterator& operator+=(difference_type n){
+                compareChanges();
+                index+= n;
+                return *this;
+            }
+            OrderIterator& operator-=(difference_type n){
+                return *this+= -n;
+            }
+            OrderIterator operator+(difference_type n) const{
+                OrderIterator result= *this;
+                return result+= n;
+            }
+            friend OrderIterator operator+(difference_type n, const OrderIterator& it){
+                return it+ n;
+            }
+            OrderIterator operator-(difference_type n) const{
+                OrderIterator result= *this;
+                return result-= n;
+            }
+            difference_type operator-(const OrderIterator& other) const{
+                compareChanges();
+                return static_cast<difference_type>(index)- static_cast<difference_type>(other.index);
+            }
+
             //This operator checks if the current iterator position not equal to the end position. It is used to determine if the iteration should continue.
-            bool operator!=(const IteratorBase& other) const{
+            bool operator!=(const OrderIterator& other) const{
                 compareChanges();
                 return index != other.index; //Inequality check
             }
 
             //This operator checks if the current iterator position equal to the other iterator position, and also checks if the data is the same. It is used for
-            //testing equality between two iterators.
-            bool operator==(const IteratorBase& other) const{
+            //testing equality between two iterators. Iterators of the same snapshot share the buffer, so the elements are compared only if not.
+            //Value-initialized iterators have no buffer: they are equal to each other (like two null pointers) and to no bound iterator.
+            bool operator==(const OrderIterator& other) const{
+                compareChanges();
+                return index == other.index && (data == other.data || (data!= nullptr && other.data!= nullptr && *data == *other.data)); //Equality check
+            }
+
+            //Positions of two iterators of the same order
+            bool operator<(const OrderIterator& other) const{
                 compareChanges();
-                return index == other.index && data == other.data; //Equality check
+                return index< other.index;
+            }
+            bool operator>(const OrderIterator& other) const{
+                return other< *this;
+            }
+            bool operator<=(const OrderIterator& other) const{
+                return !(other< *this);
+            }
+            bool operator>=(const OrderIterator& other) const{
+                return !(*this< other);
             }
     };
 
-    //MyContainer: A generic container for int, double, or string. Includes methods to add/remove elements and iterators for various traversal orders that
-    //inherit from IteratorBase.
+//OrderView: a whole order of one snapshot as a contiguous range (begin()/end() are pointers into the shared order buffer). A view can be split
+//into sub-views that share the same buffer, for example to give each thread of a pool its own part of one traversal.
+    template<typename T>
+    class OrderView{
+        private:
+            shared_ptr<const OrderSnapshot<T>> snapshot; //Keeps the order buffer alive
+            const T* first; //First element of this view inside the order buffer
+            size_t count; //Number of elements in this view
+            const atomic<uint64_t>* currentChanges; //Pointer to the change counter in MyContainer
+            uint64_t changesAtCreateView; //Generation of the snapshot
 
-    template <typename T=int>//Default type is int, but can be specialized for double or string, like we asked.
-    class MyContainer{
-        //Using static_assert for compile-time type checking to ensure T is one of the allowed types.
-        static_assert(
-            std::is_same_v<T, int> || std::is_same_v<T, double> || std::is_same_v<T, std::string>,
-            "MyContainer supports only int, double, or string"
-        );
+        public:
+            OrderView(shared_ptr<const OrderSnapshot<T>> shared, const OrderBuffer<T>& order, const atomic<uint64_t>* counter):
+                snapshot(std::move(shared)), first(order.data()), count(order.size()), currentChanges(counter),
+                changesAtCreateView(snapshot->getGeneration()){}
 
+            //Throw like the iterators if the container has changed since the view was created
+            void compareChanges() const{
+                if(currentChanges->load(memory_order_acquire)!= changesAtCreateView){
+                    throw runtime_error("View invalid because the container was modified");
+                }
+            }
+
+            //begin() checks the generation once, the loop over the pointers then has no check at all
+            const T* begin() const{
+                compareChanges();
+                return first;
+            }
+            const T* end() const{
+                return first+ count;
+            }
+            size_t size() const{
+                return count;
+            }
+            bool empty() const{
+                return count== 0;
+            }
+            const T& operator[](size_t i) const{
+                return first[i];
+            }
+
+            //Part of the view from position from, with length elements, sharing the same buffer
+            OrderView subview(size_t from, size_t length) const{
+                if(from> count || length> count- from){
+                    throw out_of_range("Subview out of the range of the view");
+                }
+                OrderView part= *this;
+                part.first= first+ from;
+                part.count= length;
+                return part;
+            }
+
+            //Split into (at most) parts contiguous sub-views of almost equal size. Empty parts are not returned.
+            vector<OrderView> split(size_t parts) const{
+                vector<OrderView> result;
+                parts= max<size_t>(1, min(parts, count));
+                size_t from= 0;
+                for(size_t i= 0; i< parts && from< count; ++i){
+                    size_t length= count/ parts+ (i< count% parts? 1: 0);
+                    result.push_back(subview(from, length));
+                    from+= length;
+                }
+                return result;
+            }
+    };
+
+    //MyContainer: A generic container for any totally ordered type (int, double, string, int64_t, float, ...). Includes methods to add/remove
+    //elements and iterators for various traversal orders (OrderIterator with an order policy).
+
+    //Storage is the type that holds the elements: vector<T> by default, or any type with the same interface that is used here (begin, end, size,
+    //push_back, insert at the end, erase, operator[]), for example MappedVector<T> that keeps the elements in a memory-mapped file.
+    //T must have <, >, <=, >=, == and != that agree (std::totally_ordered), checked at compile-time. Integer and floating types are sorted with the
+    //fast kernels of SortKernels.hpp (sorting networks and radix sort), the other types with std::sort.
+    //Compare and Projection define the ascending order of the sorted orders (ascending, descending, side cross, middle out): a is before b if
+    //Compare(Projection(a), Projection(b)). For example MyContainer<double, vector<double>, ranges::less, AbsoluteValue> sorts by absolute value.
+    //A projection to an integer or floating key is radix sorted by that key.
+    template <typename T=int, typename Storage= vector<T>, typename Compare= ranges::less, typename Projection= identity> //Default type is int
+        requires std::totally_ordered<T> && std::indirect_strict_weak_order<Compare, std::projected<const T*, Projection>>
+    class MyContainer{
         private:
-            vector<T> data; //Data storage in a vector. Using vector for dynamic array-like behavior, allowing easy addition/removal of elements.
-            int changes = 0; //Changes counter for iterator validation
+            Storage data; //Data storage in a vector (by default). Using vector for dynamic array-like behavior, allowing easy addition/removal of elements.
+            atomic<uint64_t> changes{0}; //Changes counter (generation) for iterator validation. Atomic 64-bit so it never wraps and can be read
+            //by iterators on other threads.
+            mutable atomic<shared_ptr<const OrderSnapshot<T>>> published; //Last snapshot given to iterators, reused while the generation is the same
+            mutable atomic<shared_ptr<OrderSnapshot<T>>> spare; //Old snapshot that nobody holds anymore, its buffers are reused by the next one
+            pmr::memory_resource* resource= pmr::get_default_resource(); //Memory of the snapshots and their order buffers
+
+            //The sorter of the snapshots of this container. Compare and Projection are made here, so they must be default constructible. The
+            //scratch space of the sort comes from the resource of the buffer, like all the other buffers of the snapshot.
+            static void sortBuffer(OrderBuffer<T>& buffer){
+                sortElements(buffer.begin(), buffer.end(), Compare(), Projection(), buffer.get_allocator().resource());
+            }
+
+            //Called after every modification: drop the published snapshot, so it is deleted as soon as its last iterator is gone
+            void modified(){
+                changes.fetch_add(1, memory_order_release); //Now the iterator not valid for another action because the container has changed.
+                published.store(nullptr, memory_order_release);
+            }
 
         public:
             MyContainer() = default; //Default constructor for creating an empty container. In the iterators implemented a constructor I takes a
             //MyContainer object and initializes the iterator with its data.
 
+            //Container over a storage that already has elements, for example a MappedVector opened on an existing file. The snapshots and
+            //their order buffers (what the iterators read) allocate from snapshotResource.
+            explicit MyContainer(Storage storage, pmr::memory_resource* snapshotResource= pmr::get_default_resource()):
+                data(std::move(storage)), resource(snapshotResource){}
+
+            //Container where the storage, the snapshots and the order buffers all allocate from one memory resource, for a storage with a
+            //polymorphic allocator (pmr::vector, see PmrContainer)
+            explicit MyContainer(pmr::memory_resource* memory) requires std::is_constructible_v<Storage, pmr::polymorphic_allocator<T>>:
+                data(pmr::polymorphic_allocator<T>(memory)), resource(memory){}
+
+            //atomic is not copyable, so the copy operations are written by hand. A copy starts with the generation of the source.
+            //A snapshot is immutable, so the copy can share the published one.
+            MyContainer(const MyContainer& other): data(other.data), changes(other.getChanges()), published(other.published.load(memory_order_acquire)),
+                resource(other.resource){}
+            MyContainer& operator=(const MyContainer& other){
+                if(this!= &other){
+                    data= other.data;
+                    modified(); //Assignment is a modification, old iterators become invalid
+                }
+                return *this;
+            }
+
+            //Move: also for storages that can not be copied (like a mapped file). The moved container keeps the generation and the snapshot.
+            MyContainer(MyContainer&& other) noexcept: data(std::move(other.data)), changes(other.getChanges()),
+                published(other.published.load(memory_order_acquire)), resource(other.resource){
+                other.modified(); //The data left the other container, its old iterators are invalid
+            }
+            MyContainer& operator=(MyContainer&& other) noexcept{
+                if(this!= &other){
+                    data= std::move(other.data);
+                    modified();
+                    other.modified();
+                }
+                return *this;
+            }
+
             //Add a new element and increment the change counter
             void addElement(const T& element){
                 data.push_back(element);
-                changes++; //Now the iterator not valid for another action because the container has changed.
+                modified();
+            }
+
+            //Add a batch of elements with one allocation and one change of the counter, instead of one for each element
+            template<typename InputIt>
+            void addElements(InputIt first, InputIt last){
+                data.insert(data.end(), first, last);
+                modified();
+            }
+
+            //Add several batches in their order, with room reserved once for all of them and one change of the counter
+            void addBatches(vector<vector<T>>&& batches){
+                size_t total= data.size();
+                for(const auto& batch: batches){
+                    total+= batch.size();
+                }
+                data.reserve(total);
+                for(auto& batch: batches){
+                    data.insert(data.end(), make_move_iterator(batch.begin()), make_move_iterator(batch.end()));
+                }
+                modified();
             }
 
             //Remove all occurrences of the given element, or throw if not found
@@ -109,7 +713,7 @@ namespace exercise4{
                     throw invalid_argument("Element not found in the container");
                 }
                 data.erase(it, data.end()); //This function erases the elements from the vector that were removed by std::remove.
-                ++changes; //Now the iterator not valid for another action because the container has changed.
+                modified();
             }
 
             //Return number of elements in the container
@@ -119,12 +723,12 @@ namespace exercise4{
 
             //Output container contents in [ , , ...] format
             //Friend function to allow access to private members for printing, the operator<< is overloaded to print the container elements.
-            friend ostream& operator<<(ostream& os, const MyContainer<T>& container){
+            friend ostream& operator<<(ostream& os, const MyContainer& container){
                 os<< "[";
-                for(size_t i= 0; i< container.data.size(); ++i){
-                    os<< container.data[i];
-                    if (i!= container.data.size()- 1){ //If not the last element, add a ,
-                        os<< ", ";
+                if(container.data.size()> 0){
+                    os<< container.data[0]; //The first element is written before the loop, so the loop has no branch for the ,
+                    for(size_t i= 1; i< container.data.size(); ++i){
+                        os<< ", "<< container.data[i];
                     }
                 }
                 os<< "]"; //Its the end of the output format
@@ -134,152 +738,70 @@ namespace exercise4{
             //Helper getters for iterators implementation
             //Get the data:2. For copy of the data at the time of iterator creation.
             vector<T> getElements() const{
-            return data;
+            return vector<T>(data.begin(), data.end());
+            }
+            //Get the storage itself, read only, for code that needs all the elements without a copy (like saving to a file)
+            const Storage& getStorage() const{
+                return data;
+            }
+            //Get the memory resource of the snapshots
+            pmr::memory_resource* getResource() const{
+                return resource;
             }
             //Get the changes counter (at the time of creation of the iterator):
-            int getChanges() const{
-                return changes;
+            uint64_t getChanges() const{
+                return changes.load(memory_order_acquire);
             }
             //Get a pointer to the changes counter, used by iterators to check if the container has changed since iterator creation.
-            const int* getChangesPointer() const{
+            const atomic<uint64_t>* getChangesPointer() const{
                 return &changes;
             }
 
-        //Iterators in this container class: each iterator has its own order logic and inherits from IteratorBase the overloaded operators.
-        //In this part of the code I implement constructors for each iterator type.
-
-        class AscendingOrder: public IteratorBase<T>{
-            public:
-                AscendingOrder(const MyContainer<T>& container, bool end= false){
-                    this->data= container.getElements(); 
-                    sort(this->data.begin(), this->data.end()); //Using std::sort to sort the data in ascending order
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer(); 
-                    this->changesAtCreateIter= container.getChanges(); 
-                }
-        };
-
-        class DescendingOrder: public IteratorBase<T>{
-            public:
-                DescendingOrder(const MyContainer<T>& container, bool end= false){
-                    this->data= container.getElements();
-                    sort(this->data.begin(), this->data.end(), greater<T>());//Using std::sort with greater<T>() to sort the data in descending order
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer();
-                    this->changesAtCreateIter= container.getChanges();
+            //Return the published snapshot if it is of the current generation, otherwise nullptr. Does not read the data, so a reader thread can
+            //call it without a lock while a writer holds the data.
+            shared_ptr<const OrderSnapshot<T>> publishedSnapshot() const{
+                shared_ptr<const OrderSnapshot<T>> current= published.load(memory_order_acquire);
+                if(current && current->getGeneration()== getChanges()){
+                    return current;
                 }
-            };
-
-        class ReverseOrder: public IteratorBase<T>{
-            public:
-                ReverseOrder(const MyContainer<T>& container, bool end= false){
-                    this->data= container.getElements();
-                    reverse(this->data.begin(), this->data.end()); //Using std::reverse to reverse the order of elements in the vector
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer();
-                    this->changesAtCreateIter= container.getChanges();
-                }
-        };
-
-        class Order: public IteratorBase<T>{
-            public:
-                //This iterator just iterates over the elements in the order they were added
-                Order(const MyContainer<T>& container, bool end= false){
-                    this->data= container.getElements();
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer();
-                    this->changesAtCreateIter= container.getChanges();
-                }
-        };
+                return nullptr;
+            }
 
-        class SideCrossOrder: public IteratorBase<T>{
-            public:
-                SideCrossOrder(const MyContainer<T>& container, bool end= false){
-                    vector<T> sorted= container.getElements(); //Create a copy of the elements
-                    sort(sorted.begin(), sorted.end()); //Sort the elements in ascending order
-                    this->data.clear(); //Clear the data from the original vector
-
-                    //point to the beginning and end of the container
-                    int left= 0;
-                    int right= sorted.size()- 1;
-                    while(left <= right){ //While the left index is less than or equal to the right index
-                        this->data.push_back(sorted[left++]); //Add the leftmost element
-                        if(left <= right){
-                            this->data.push_back(sorted[right--]);//Add the rightmost element
-                        }
+            //Return the snapshot of the current generation, making and publishing it on the first call after a modification. The data is copied
+            //once for each generation, not once for each iterator.
+            shared_ptr<const OrderSnapshot<T>> snapshot() const{
+                shared_ptr<const OrderSnapshot<T>> current= publishedSnapshot();
+                if(!current){
+                    shared_ptr<OrderSnapshot<T>> fresh= spare.exchange(nullptr, memory_order_acq_rel);
+                    if(fresh){
+                        fresh->reuse(data.begin(), data.end(), getChanges());
                     }
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer();
-                    this->changesAtCreateIter= container.getChanges();
-                }
-        };
-
-        //To handle with memory leak, I use size_t because .size() returns size_t= unsigned long and its problem to compare with int.
-        class MiddleOutOrder: public IteratorBase<T>{
-            public:
-                MiddleOutOrder(const MyContainer<T>& container, bool end= false){
-                //Create a copy of the elements and sort them
-                vector<T> sorted= container.getElements();
-                sort(sorted.begin(), sorted.end());
-                this->data.clear(); //Clear the data from the original vector
-
-                size_t size= sorted.size(); //Get the size of the sorted vector
-                //If the size is 0, set the index to 0
-                if(size== 0){
-                    this->index = 0;
-                }
-                //If the size is odd, start from the middle and alternate between left and right elements
-                if(size%2== 1){
-                    size_t mid= size/ 2;
-                    this->data.push_back(sorted[mid]);
-                    size_t left= mid- 1;
-                    size_t right= mid+ 1;
-                    bool leftTurn= true;
-                    //Alternating between left and right elements until all elements are added
-                    while(left< size || right< size){
-                        //Left
-                        if(leftTurn&& left< size){
-                            this->data.push_back(sorted[left--]);
-                        }
-                        //Right
-                        if(!leftTurn && right< size){
-                            this->data.push_back(sorted[right++]);
-                        }
-                        leftTurn= !leftTurn; //Switch between left and right
+                    else{
+                        fresh= allocate_shared<OrderSnapshot<T>>(pmr::polymorphic_allocator<OrderSnapshot<T>>(resource), data.begin(), data.end(),
+                            getChanges(), resource, &sortBuffer);
                     }
+                    current= std::move(fresh);
+                    published.store(current, memory_order_release);
                 }
-                //If the size is even, start from the left of center and alternate between left and right elements
-                else{
-                    //Mid_left is the left middle element and mid_right is the right middle element
-                    size_t mid_left= size/ 2-1;
-                    size_t mid_right= size/ 2; 
-                    this->data.push_back(sorted[mid_left]);
+                return current;
+            }
 
-                    size_t left= (mid_left> 0)? mid_left- 1: size; //If mid_left is 0, set left to size to avoid out of range
-                    size_t right= mid_right; //Start from the right middle element at the right side
-                    bool rightTurn= true;
-                    //Start from the right of center and alternate between left and right elements until all elements are added
-                    while(left< size || right< size){
-                        if(rightTurn && right< size){
-                            this->data.push_back(sorted[right++]);
-                        }
-                        else if(!rightTurn && left< size){
-                            this->data.push_back(sorted[left--]);
-                        }
-                        rightTurn= !rightTurn; //Switch between left and rights
-                    }
-                }
-                    this->index= end? this->data.size(): 0; //If end is true, set index to the size of data, otherwise set it to 0
-                    //Set the current changes pointer and the changes at the time of iterator creation for comparing later
-                    this->currentChanges= container.getChangesPointer();
-                    this->changesAtCreateIter= container.getChanges();
+            //Take back a snapshot from an iterator that does not need it anymore. If it was the last reference, keep it as the spare snapshot,
+            //so the next snapshot reuses its buffers instead of allocating new ones.
+            void recycle(shared_ptr<const OrderSnapshot<T>> old) const{
+                if(old && old.use_count()== 1 && old->getResource()== resource){
+                    spare.store(const_pointer_cast<OrderSnapshot<T>>(std::move(old)), memory_order_release);
                 }
-        };
+            }
+
+        //Iterators of this container: the six orders are the same OrderIterator template with a different order policy. Each one can be made from
+        //the container (uses its current snapshot) or from a snapshot that was taken before.
+        using AscendingOrder= OrderIterator<T, orders::Ascending>;
+        using DescendingOrder= OrderIterator<T, orders::Descending>;
+        using ReverseOrder= OrderIterator<T, orders::Reverse>;
+        using Order= OrderIterator<T, orders::Insertion>; //This iterator just iterates over the elements in the order they were added
+        using SideCrossOrder= OrderIterator<T, orders::SideCross>;
+        using MiddleOutOrder= OrderIterator<T, orders::MiddleOut>;
 
         //Iterator Accessors: each function creates and returns a begin/ end iterator of a specific order. Used for iterating over the container in different orders.
         //After the implementation of the iterators, I implement the begin and end functions for each iterator type because they are used to create the iterators.
@@ -324,5 +846,158 @@ namespace exercise4{
         MiddleOutOrder end_middle_out_order() const{
             return MiddleOutOrder(*this, true); //Create MiddleOutOrder iterator with *this as the container and true to indicate the end of the iteration
         }
+
+        //Custom order: map(pos, size) returns the index of position pos in the sorted buffer (sorted= true) or in the insertion order. The iterator
+        //is the same random access OrderIterator, it computes each element when it is read, so the order is never copied. For example a stride:
+        //c.begin_custom_order([](size_t pos, size_t size){ return pos* 3% size; })
+        template<typename Map>
+        OrderIterator<T, orders::Mapped<Map>> begin_custom_order(Map map, bool sorted= false) const{
+            return OrderIterator<T, orders::Mapped<Map>>(*this, false, orders::Mapped<Map>(std::move(map), sorted));
+        }
+        template<typename Map>
+        OrderIterator<T, orders::Mapped<Map>> end_custom_order(Map map, bool sorted= false) const{
+            return OrderIterator<T, orders::Mapped<Map>>(*this, true, orders::Mapped<Map>(std::move(map), sorted));
+        }
+
+        //Publish a snapshot whose ascending order is already known, for example saved in a file: sorted must hold the elements of the container
+        //in the order of the container. The order is checked with one sequential pass of the comparator, and that sorted holds the same elements
+        //with one pass over each (multisetHash), which costs O(n) instead of the O(n log n) sort. Returns false, and changes nothing, if the
+        //size, the order or the elements are wrong, or the element type has no hash.
+        bool seedAscendingOrder(OrderBuffer<T> sorted){
+            if(sorted.size()!= data.size() || !ranges::is_sorted(sorted, Compare(), Projection())){
+                return false;
+            }
+            optional<uint64_t> hashOfSorted= multisetHash(sorted);
+            if(!hashOfSorted || hashOfSorted!= multisetHash(data)){
+                return false;
+            }
+            published.store(allocate_shared<OrderSnapshot<T>>(pmr::polymorphic_allocator<OrderSnapshot<T>>(resource), data.begin(), data.end(),
+                getChanges(), resource, std::move(sorted), &sortBuffer), memory_order_release);
+            return true;
+        }
+
+        private:
+            //Coroutine behind the lazy accessors. It is a static function that holds the snapshot itself, so the generator stays valid also if it
+            //lives longer than the container. Every resume checks the generation like the iterators. The element of position pos is
+            //source[Policy::index(pos, size)], the same order policies as the iterators, so orders built from another buffer are never materialized.
+            template<typename Policy>
+            static Generator<T> generate(shared_ptr<const OrderSnapshot<T>> shared, const atomic<uint64_t>* counter){
+                uint64_t changesAtCreate= shared->getGeneration();
+                const OrderBuffer<T>& source= Policy::source(*shared);
+                size_t size= source.size();
+                for(size_t pos= 0; pos< size; ++pos){
+                    if(counter->load(memory_order_acquire)!= changesAtCreate){
+                        throw runtime_error("Generator invalid because the container was modified");
+                    }
+                    co_yield source[Policy::index(pos, size)];
+                }
+            }
+
+        public:
+        //Lazy Accessors: each function returns a coroutine generator of a specific order. The elements are computed one at a time while the caller
+        //iterates. Side cross and middle out read the sorted buffer through their index maps, and reverse reads the insertion buffer backwards.
+        Generator<T> lazy_ascending_order() const{
+            return generate<orders::Ascending>(snapshot(), getChangesPointer());
+        }
+        Generator<T> lazy_descending_order() const{
+            return generate<orders::Descending>(snapshot(), getChangesPointer());
+        }
+        Generator<T> lazy_reverse_order() const{
+            return generate<orders::Reverse>(snapshot(), getChangesPointer());
+        }
+        Generator<T> lazy_order() const{
+            return generate<orders::Insertion>(snapshot(), getChangesPointer());
+        }
+        Generator<T> lazy_side_cross_order() const{
+            return generate<orders::SideCross>(snapshot(), getChangesPointer());
+        }
+        Generator<T> lazy_middle_out_order() const{
+            return generate<orders::MiddleOut>(snapshot(), getChangesPointer());
+        }
+
+        //View Accessors: each function returns the whole order of the current snapshot as one OrderView, which can be split for parallel work
+        OrderView<T> ascending_order() const{
+            return view(OrderKind::Ascending);
+        }
+        OrderView<T> descending_order() const{
+            return view(OrderKind::Descending);
+        }
+        OrderView<T> reverse_order() const{
+            return view(OrderKind::Reverse);
+        }
+        OrderView<T> order() const{
+            return view(OrderKind::Insertion);
+        }
+        OrderView<T> side_cross_order() const{
+            return view(OrderKind::SideCross);
+        }
+        OrderView<T> middle_out_order() const{
+            return view(OrderKind::MiddleOut);
+        }
+
+        //The order chosen at run time, as the same OrderView type for all the orders. The choice is made once here: the view points to the shared
+        //buffer of that order in the snapshot, so the loop over it has no switch and costs the same as any other view.
+        OrderView<T> view(OrderKind kind) const{
+            auto shared= snapshot();
+            return OrderView<T>(shared, shared->materialized(kind), getChangesPointer());
+        }
+
+        //Write a whole order into memory of the caller, starting at out. Insertion and reverse are copied straight from the storage. Ascending
+        //and descending into contiguous memory (a span, a pointer) are sorted right there when no snapshot has the sorted buffer yet: the
+        //storage is copied once into out and sorted in place (descending is then reversed), so no snapshot is made. Otherwise the orders are read
+        //from the sorted buffer of the snapshot (descending backwards, side cross and middle out with their index maps), and that buffer is
+        //kept for later iterators. Returns the output iterator after the last element.
+        template<typename OutputIt> requires output_iterator<OutputIt, const T&>
+        OutputIt copy_order_into(OrderKind kind, OutputIt out) const{
+            if(kind== OrderKind::Insertion){
+                return std::copy(data.begin(), data.end(), out);
+            }
+            if(kind== OrderKind::Reverse){
+                return std::reverse_copy(data.begin(), data.end(), out);
+            }
+            if constexpr(requires{ requires contiguous_iterator<OutputIt>; requires same_as<iter_value_t<OutputIt>, T>; }){
+                shared_ptr<const OrderSnapshot<T>> current= publishedSnapshot();
+                if((kind== OrderKind::Ascending || kind== OrderKind::Descending) && !(current && current->hasAscending())){
+                    OutputIt last= std::copy(data.begin(), data.end(), out);
+                    sortElements(out, last, Compare(), Projection(), resource);
+                    if(kind== OrderKind::Descending){
+                        std::reverse(out, last);
+                    }
+                    return last;
+                }
+            }
+            auto shared= snapshot();
+            const OrderBuffer<T>& sorted= shared->ascending();
+            size_t size= sorted.size();
+            switch(kind){
+                case OrderKind::Ascending:
+                    return std::copy(sorted.begin(), sorted.end(), out);
+                case OrderKind::Descending:
+                    return std::reverse_copy(sorted.begin(), sorted.end(), out);
+                case OrderKind::SideCross:
+                    for(size_t pos= 0; pos< size; ++pos){
+                        *out++= sorted[sideCrossIndex(pos, size)];
+                    }
+                    return out;
+                default: //MiddleOut
+                    for(size_t pos= 0; pos< size; ++pos){
+                        *out++= sorted[middleOutIndex(pos, size)];
+                    }
+                    return out;
+            }
+        }
+
+        //Same, into a buffer of the caller that must have room for all the elements. Returns the number of elements written.
+        size_t copy_order_into(OrderKind kind, span<T> out) const{
+            if(out.size()< data.size()){
+                throw invalid_argument("The buffer is smaller than the container");
+            }
+            copy_order_into(kind, out.begin());
+            return data.size();
+        }
     }; //End of MyContainer class
+
+    //Container whose storage, snapshots and order buffers all use one memory resource: PmrContainer<int> c(&arena);
+    template<typename T=int>
+    using PmrContainer= MyContainer<T, pmr::vector<T>>;
 } //End of namespace exercise4
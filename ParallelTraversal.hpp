@@ -0,0 +1,200 @@
+//vanunuraz@gmail.com
+//This header lets all the cores process one traversal of a "MyContainer" together.
+
+//"WorkStealingPool" is a thread pool where each worker has its own task queue. A worker takes tasks from the back of its own queue, and when it
+//is empty it steals from the front of the queues of the other workers, so the work stays balanced when the parts take different time.
+//parallel_for_each splits an OrderView (the shared materialized order of one snapshot) into contiguous parts and runs one task for each part.
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <latch>
+#include <thread>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    class WorkStealingPool{
+        private:
+            struct Queue{
+                mutex lock;
+                deque<function<void()>> tasks;
+            };
+
+            vector<unique_ptr<Queue>> queues; //One queue for each worker
+            vector<thread> workers;
+            atomic<size_t> pending{0}; //Number of queued tasks, the workers sleep while it is 0
+            atomic<size_t> nextQueue{0}; //Round robin for tasks submitted from outside the pool
+            atomic<bool> stopping{false};
+            mutex sleepLock;
+            condition_variable wake;
+
+            //Index of the worker running on this thread in this pool, or -1 for other threads
+            static int& workerIndex(){
+                static thread_local int index= -1;
+                return index;
+            }
+            static WorkStealingPool*& workerPool(){
+                static thread_local WorkStealingPool* pool= nullptr;
+                return pool;
+            }
+
+            //Take a task: first from the back of the own queue, then steal from the front of the others
+            bool takeTask(size_t own, function<void()>& task){
+                {
+                    lock_guard<mutex> guard(queues[own]->lock);
+                    if(!queues[own]->tasks.empty()){
+                        task= std::move(queues[own]->tasks.back());
+                        queues[own]->tasks.pop_back();
+                        pending.fetch_sub(1, memory_order_acq_rel);
+                        return true;
+                    }
+                }
+                for(size_t i= 1; i< queues.size(); ++i){
+                    Queue& victim= *queues[(own+ i)% queues.size()];
+                    lock_guard<mutex> guard(victim.lock);
+                    if(!victim.tasks.empty()){
+                        task= std::move(victim.tasks.front());
+                        victim.tasks.pop_front();
+                        pending.fetch_sub(1, memory_order_acq_rel);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void workerLoop(size_t own){
+                workerIndex()= static_cast<int>(own);
+                workerPool()= this;
+                function<void()> task;
+                while(true){
+                    if(takeTask(own, task)){
+                        task();
+                        continue;
+                    }
+                    unique_lock<mutex> guard(sleepLock);
+                    wake.wait(guard, [this](){ return pending.load(memory_order_acquire)> 0 || stopping.load(memory_order_acquire); });
+                    if(stopping.load(memory_order_acquire) && pending.load(memory_order_acquire)== 0){
+                        return;
+                    }
+                }
+            }
+
+        public:
+            explicit WorkStealingPool(size_t threads= max(1u, thread::hardware_concurrency())){
+                threads= max<size_t>(threads, 1);
+                for(size_t i= 0; i< threads; ++i){
+                    queues.push_back(make_unique<Queue>());
+                }
+                for(size_t i= 0; i< threads; ++i){
+                    workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+                }
+            }
+
+            WorkStealingPool(const WorkStealingPool&) = delete;
+            WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+            //Finish the queued tasks and join the workers
+            ~WorkStealingPool(){
+                {
+                    lock_guard<mutex> guard(sleepLock);
+                    stopping.store(true, memory_order_release);
+                }
+                wake.notify_all();
+                for(auto& worker: workers){
+                    worker.join();
+                }
+            }
+
+            size_t size() const{
+                return workers.size();
+            }
+
+            //Queue a task. A worker pushes to its own queue (good for cache), other threads spread the tasks round robin.
+            void submit(function<void()> task){
+                size_t target= (workerPool()== this)? static_cast<size_t>(workerIndex()): nextQueue.fetch_add(1, memory_order_relaxed)% queues.size();
+                {
+                    lock_guard<mutex> guard(queues[target]->lock);
+                    queues[target]->tasks.push_back(std::move(task));
+                }
+                pending.fetch_add(1, memory_order_acq_rel);
+                {
+                    lock_guard<mutex> guard(sleepLock); //So a worker that just checked pending can not miss the notify
+                }
+                wake.notify_one();
+            }
+
+            //Run one queued task on the calling thread if there is one. Used by a thread that waits for its tasks, so it helps instead of blocking
+            //(and a worker that waits can not deadlock the pool).
+            bool runPendingTask(){
+                function<void()> task;
+                size_t own= (workerPool()== this)? static_cast<size_t>(workerIndex()): 0;
+                if(takeTask(own, task)){
+                    task();
+                    return true;
+                }
+                return false;
+            }
+    };
+
+    //Pool shared by the parallel functions when no pool is given, one worker for each core
+    inline WorkStealingPool& defaultPool(){
+        static WorkStealingPool pool;
+        return pool;
+    }
+
+    //Run func(0), func(1), ..., func(tasks-1) on the pool and wait for all of them. The waiting thread runs queued tasks too. The first exception
+    //of a task is thrown again here, after all the tasks finished.
+    template<typename Func>
+    void run_parallel(size_t tasks, Func func, WorkStealingPool& pool= defaultPool()){
+        if(tasks== 0){
+            return;
+        }
+        latch done(static_cast<ptrdiff_t>(tasks));
+        mutex errorLock;
+        exception_ptr error;
+        for(size_t i= 0; i< tasks; ++i){
+            pool.submit([&func, &done, &errorLock, &error, i](){
+                try{
+                    func(i);
+                }
+                catch(...){
+                    lock_guard<mutex> guard(errorLock);
+                    if(!error){
+                        error= current_exception();
+                    }
+                }
+                done.count_down();
+            });
+        }
+        while(!done.try_wait()){
+            if(!pool.runPendingTask()){
+                this_thread::yield();
+            }
+        }
+        if(error){
+            rethrow_exception(error);
+        }
+    }
+
+    //Run func(part) for contiguous parts of the view on the pool, and wait for all of them.
+    //By default the view is split into 4 parts for each worker, so stealing can balance uneven parts.
+    template<typename T, typename Func>
+    void parallel_for_each_range(const OrderView<T>& view, Func func, WorkStealingPool& pool= defaultPool(), size_t parts= 0){
+        view.compareChanges();
+        vector<OrderView<T>> pieces= view.split(parts== 0? pool.size()* 4: parts);
+        run_parallel(pieces.size(), [&func, &pieces](size_t i){ func(pieces[i]); }, pool);
+    }
+
+    //Run func(element) for every element of the view, with the parts of the view on different threads
+    template<typename T, typename Func>
+    void parallel_for_each(const OrderView<T>& view, Func func, WorkStealingPool& pool= defaultPool(), size_t parts= 0){
+        parallel_for_each_range(view, [&func](const OrderView<T>& piece){
+            for(const T& element: piece){ //begin() checks the generation once for each part
+                func(element);
+            }
+        }, pool, parts);
+    }
+} //End of namespace exercise4
@@ -0,0 +1,245 @@
+//vanunuraz@gmail.com
+//This header saves a "MyContainer" to a binary file and loads it back, much faster than printing and parsing text.
+
+//File format (version 2), all numbers little-endian. The elements can be any integer or floating type, or string:
+//  header: magic "MYCSNAP\0" (8 bytes), version (uint32), type tag (uint32), count (uint64), flags (uint64)
+//  numbers: the elements as one raw array (count * sizeof(T) bytes)
+//  string: offsets table of count+1 uint64 values, then one blob with all the characters; element i is blob[offsets[i], offsets[i+1])
+//  optional sorted order (flag HasSortedOrder): the elements again in ascending order, in the same layout. Side cross and middle out are not
+//  stored: they are index maps of the ascending order.
+//Loading numbers is one allocation and one bulk read directly into the storage of the new container, and a stored sorted order is one more
+//sequential read. It is used only if it is in the order of the loaded container (one is_sorted pass) and holds the loaded elements (one
+//order-independent hash of each, multisetHash), so a corrupted block is never used; then the first ascending iteration after the load does
+//not sort. Version 1 files kept a permutation instead (flag 1), their elements load and the permutation is skipped.
+
+#pragma once
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    namespace persistence{
+        constexpr char Magic[8]= {'M','Y','C','S','N','A','P','\0'};
+        constexpr uint32_t Version= 2;
+        constexpr uint64_t HasSortedOrder= 2; //Flag: the file has the elements in ascending order after the elements (flag 1 was the
+        //ascending permutation of version 1)
+
+        struct FileHeader{
+            char magic[8];
+            uint32_t version;
+            uint32_t typeTag;
+            uint64_t count;
+            uint64_t flags;
+        };
+
+        //Tag of the element type in the file, so a file of doubles is not loaded as ints. The tags of int, double and string are the ones of the
+        //first files; the other numbers are tagged by kind and size, so int64_t and long long (the same size) read each other's files.
+        template<typename T>
+        constexpr uint32_t typeTag(){
+            if constexpr(std::is_same_v<T, string>){
+                return 3;
+            }
+            else if constexpr(std::is_floating_point_v<T>){
+                static_assert(sizeof(T)== 4 || sizeof(T)== 8, "Snapshot files support float and double");
+                return sizeof(T)== 8? 2: 11;
+            }
+            else if constexpr(std::is_integral_v<T> && !std::is_same_v<T, bool>){
+                constexpr uint32_t signedTags[]= {4, 5, 1, 6}; //1, 2, 4, 8 bytes
+                constexpr uint32_t unsignedTags[]= {7, 8, 9, 10};
+                constexpr size_t at= std::bit_width(sizeof(T))- 1;
+                return std::is_signed_v<T>? signedTags[at]: unsignedTags[at];
+            }
+            else{
+                static_assert(std::is_same_v<T, string>, "Snapshot files support numbers and strings");
+                return 0;
+            }
+        }
+
+        //Reverse the bytes of a number, used only on big-endian machines
+        template<typename T>
+        T swapBytes(T value){
+            unsigned char bytes[sizeof(T)];
+            memcpy(bytes, &value, sizeof(T));
+            std::reverse(bytes, bytes+ sizeof(T));
+            memcpy(&value, bytes, sizeof(T));
+            return value;
+        }
+
+        //Write count numbers as little-endian. On little-endian machines this is one write of the whole array.
+        template<typename T>
+        void writeArray(ostream& out, const T* values, size_t count){
+            if constexpr(std::endian::native== std::endian::little){
+                out.write(reinterpret_cast<const char*>(values), static_cast<streamsize>(count* sizeof(T)));
+            }
+            else{
+                vector<T> block;
+                for(size_t i= 0; i< count; i+= 8192){
+                    size_t part= min<size_t>(8192, count- i);
+                    block.assign(values+ i, values+ i+ part);
+                    for(T& value: block){
+                        value= swapBytes(value);
+                    }
+                    out.write(reinterpret_cast<const char*>(block.data()), static_cast<streamsize>(part* sizeof(T)));
+                }
+            }
+        }
+
+        //Read count little-endian numbers into memory that is already allocated
+        template<typename T>
+        void readArray(istream& in, T* values, size_t count){
+            in.read(reinterpret_cast<char*>(values), static_cast<streamsize>(count* sizeof(T)));
+            if(!in){
+                throw runtime_error("Snapshot file is truncated");
+            }
+            if constexpr(std::endian::native!= std::endian::little){
+                for(size_t i= 0; i< count; ++i){
+                    values[i]= swapBytes(values[i]);
+                }
+            }
+        }
+
+        //Write the elements of a range: numbers as one raw array, strings as an offsets table and then all the characters in one blob
+        template<typename Range>
+        void writeElements(ostream& out, const Range& elements){
+            using T= std::ranges::range_value_t<Range>;
+            if constexpr(std::is_same_v<T, string>){
+                vector<uint64_t> offsets;
+                offsets.reserve(elements.size()+ 1);
+                uint64_t offset= 0;
+                offsets.push_back(0);
+                for(const string& element: elements){
+                    offset+= element.size();
+                    offsets.push_back(offset);
+                }
+                writeArray(out, offsets.data(), offsets.size());
+                for(const string& element: elements){
+                    out.write(element.data(), static_cast<streamsize>(element.size()));
+                }
+            }
+            else{
+                writeArray(out, std::to_address(elements.begin()), elements.size());
+            }
+        }
+
+        //Bytes from the current position to the end of the file, to check the sizes in the file before anything is allocated
+        inline uint64_t remainingBytes(istream& in){
+            streampos here= in.tellg();
+            in.seekg(0, ios::end);
+            streampos end= in.tellg();
+            in.seekg(here);
+            if(here< 0 || end< here){
+                throw runtime_error("Snapshot file can not be measured");
+            }
+            return static_cast<uint64_t>(end- here);
+        }
+
+        //Read and check the header of a snapshot file
+        template<typename T>
+        FileHeader readHeader(istream& in, const string& path){
+            FileHeader header;
+            in.read(header.magic, sizeof(header.magic));
+            readArray(in, &header.version, 1);
+            readArray(in, &header.typeTag, 1);
+            readArray(in, &header.count, 1);
+            readArray(in, &header.flags, 1);
+            if(memcmp(header.magic, Magic, sizeof(Magic))!= 0){
+                throw runtime_error(path+ " is not a MyContainer snapshot file");
+            }
+            if(header.version> Version){
+                throw runtime_error(path+ " has an unsupported snapshot version");
+            }
+            if(header.typeTag!= typeTag<T>()){
+                throw runtime_error(path+ " holds another element type");
+            }
+            return header;
+        }
+
+        //Read count elements written by writeElements into elements (a vector<T> or an order buffer). The count comes from the file, so it is
+        //checked against the rest of the file before anything is allocated: a corrupted count throws here instead of allocating (or wrapping
+        //count+ 1 to 0).
+        template<typename T, typename Vector>
+        void readElements(istream& in, Vector& elements, uint64_t count, const string& path){
+            uint64_t remaining= remainingBytes(in);
+            constexpr uint64_t elementBytes= std::is_same_v<T, string>? sizeof(uint64_t): sizeof(T); //An offset for each string
+            if(count>= remaining/ elementBytes+ (std::is_same_v<T, string>? 0: 1)){
+                throw runtime_error(path+ " is truncated or has a corrupted count");
+            }
+            size_t size= static_cast<size_t>(count);
+            if constexpr(std::is_same_v<T, string>){
+                vector<uint64_t> offsets(size+ 1);
+                readArray(in, offsets.data(), offsets.size());
+                if(offsets[size]> remaining- offsets.size()* sizeof(uint64_t)){
+                    throw runtime_error(path+ " has a corrupted offsets table");
+                }
+                string blob(static_cast<size_t>(offsets[size]), '\0');
+                in.read(blob.data(), static_cast<streamsize>(blob.size()));
+                if(!in){
+                    throw runtime_error("Snapshot file is truncated");
+                }
+                elements.reserve(size);
+                for(size_t i= 0; i< size; ++i){
+                    if(offsets[i]> offsets[i+ 1] || offsets[i+ 1]> blob.size()){
+                        throw runtime_error(path+ " has a corrupted offsets table");
+                    }
+                    elements.emplace_back(blob, offsets[i], offsets[i+ 1]- offsets[i]);
+                }
+            }
+            else{
+                elements.resize(size); //The only allocation
+                readArray(in, elements.data(), size);
+            }
+        }
+    } //End of namespace persistence
+
+    //Save the elements of the container (in insertion order) to a binary snapshot file. With withOrderIndex the ascending order of the container
+    //is saved too (from its order cache, so it is sorted at most once), and the loaded container does not sort again.
+    template<typename T, typename Storage, typename Compare, typename Projection>
+    void save(const MyContainer<T, Storage, Compare, Projection>& container, const string& path, bool withOrderIndex= false){
+        ofstream out(path, ios::binary | ios::trunc);
+        if(!out){
+            throw runtime_error("Can not open "+ path+ " for writing");
+        }
+        const Storage& storage= container.getStorage();
+        uint64_t count= storage.size();
+        out.write(persistence::Magic, sizeof(persistence::Magic));
+        uint32_t version= persistence::Version;
+        uint32_t tag= persistence::typeTag<T>();
+        uint64_t flags= withOrderIndex? persistence::HasSortedOrder: 0;
+        persistence::writeArray(out, &version, 1);
+        persistence::writeArray(out, &tag, 1);
+        persistence::writeArray(out, &count, 1);
+        persistence::writeArray(out, &flags, 1);
+        persistence::writeElements(out, storage);
+        if(withOrderIndex){
+            persistence::writeElements(out, container.snapshot()->ascending());
+        }
+        if(!out){
+            throw runtime_error("Failed writing "+ path);
+        }
+    }
+
+    //Load a snapshot file saved by save() into a new container. For a container with its own order, give its type as the second argument,
+    //load<string, MyContainer<string, vector<string>, CaseInsensitive>>(path), so a saved sorted order of that order is used.
+    template<typename T, typename Container= MyContainer<T>>
+    Container load(const string& path){
+        ifstream in(path, ios::binary);
+        if(!in){
+            throw runtime_error("Can not open "+ path+ " for reading");
+        }
+        persistence::FileHeader header= persistence::readHeader<T>(in, path);
+        vector<T> elements;
+        persistence::readElements<T>(in, elements, header.count, path);
+        Container container(std::move(elements));
+
+        if(header.flags& persistence::HasSortedOrder){
+            OrderBuffer<T> sorted(container.getResource());
+            persistence::readElements<T>(in, sorted, header.count, path);
+            container.seedAscendingOrder(std::move(sorted)); //If it is not in the order of the container, it is sorted on first use as usual
+        }
+        return container;
+    }
+} //End of namespace exercise4
@@ -0,0 +1,391 @@
+//vanunuraz@gmail.com
+//This header has the sort used for the orders of the snapshots: a sorting network for tiny ranges of numbers, radix sort for many numbers,
+//prefix keys and MSD radix sort for strings, std::sort for the rest.
+
+//For up to 32 numbers, sortElements turns the elements into their order-preserving unsigned radix keys in a small array, and runs Batcher's
+//odd-even merge sort network for exactly that many keys on it. A network is a fixed list of compare-exchange steps, computed at compile time
+//for each size. A step swaps two keys with a branchless select, so no key is lost or duplicated: a NaN has a key like any other value and
+//ends up where the radix sort puts it. Measured at -O2 and -O3 against std::sort on 200K arrays of each size from 2 to 32 (make bench), the
+//network on keys is faster for int, int64, float, double and uint8; on the element values with min/max it was slower for integers.
+//Larger ranges of integers and of float/double are sorted with an LSD radix sort (one pass for each byte of the key, a pass is skipped when all
+//the elements have the same byte). Strings are sorted by an 8-byte big-endian key of each one, taken after the prefix that all of them share
+//(every URL starts with "https://", so a key at depth 0 would be the same for all): the (key, index) pairs are radix sorted, and strings are
+//compared only when their keys are equal. From 16K strings, equal keys go on to the next 8 bytes instead (MSD radix sort), so long shared
+//prefixes like paths are not compared again and again. The keys of 32 strings spread over the range are sorted first; if many of them repeat
+//(URLs of a few sites), the keys would not tell the strings apart, and the range goes to MSD radix sort from 4096 strings and to std::sort
+//below. Measured with make bench against std::sort at -O2, the string kernels win from 256 strings on words and numbered names, and on
+//URLs of a few sites from 4096 (below it they lost 10-50%). All the other types use std::sort. A container with its own comparator and
+//projection uses the overload with comp and proj at the end. The scratch buffers of the radix passes come from the memory resource given to
+//sortElements (the snapshot passes its own), so a container on an arena does not touch the global heap while it sorts.
+
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace exercise4{
+
+    namespace sorting{
+        constexpr std::size_t NetworkLimit= 32; //Largest range sorted with a network
+        constexpr std::size_t RadixThreshold= 256; //Smallest range sorted with radix sort, below it std::sort is faster
+        constexpr std::size_t StringPrefixThreshold= 256; //Smallest range of strings sorted by prefix keys
+        constexpr std::size_t StringGroupThreshold= 64; //Smallest group of strings radix sorted by an MSD level, smaller ones are compared
+        constexpr std::size_t StringMsdThreshold= 1<< 14; //Smallest range of strings sorted with MSD radix sort
+        constexpr std::size_t StringMsdTiesThreshold= 1<< 12; //Smallest range sorted with MSD radix sort when the prefix keys repeat
+        constexpr std::size_t PrefixSample= 32; //Strings whose keys are sampled to see if the keys repeat
+
+        //Types with a radix key: integers (not bool) and IEEE float/double
+        template<typename T>
+        constexpr bool hasRadixKey= (std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+            (std::is_floating_point_v<T> && std::numeric_limits<T>::is_iec559 && (sizeof(T)== 4 || sizeof(T)== 8));
+
+        //Unsigned key with the same order as the value: the sign bit of signed integers is flipped, and for floating types negative numbers
+        //have all their bits flipped (so larger magnitude is smaller) and positive numbers only the sign bit
+        template<typename T>
+        auto radixKey(T value){
+            if constexpr(std::is_integral_v<T>){
+                using Key= std::make_unsigned_t<T>;
+                Key key= static_cast<Key>(value);
+                if constexpr(std::is_signed_v<T>){
+                    key^= Key(1)<< (sizeof(Key)* 8- 1);
+                }
+                return key;
+            }
+            else{
+                using Key= std::conditional_t<sizeof(T)== 4, std::uint32_t, std::uint64_t>;
+                Key bits= std::bit_cast<Key>(value);
+                Key sign= Key(1)<< (sizeof(Key)* 8- 1);
+                return (bits& sign)? Key(~bits): Key(bits| sign);
+            }
+        }
+
+        //LSD radix sort of count values by the key of proj(value), one byte of the key in each pass, with a buffer of the same size from resource.
+        //It is a stable sort, elements with the same key keep their order.
+        template<typename T, typename Projection>
+        void radixSort(T* values, std::size_t count, Projection proj, std::pmr::memory_resource* resource){
+            auto digit= [&proj](const T& value, std::size_t shift){ return static_cast<std::size_t>((radixKey(std::invoke(proj, value))>> shift)& 0xFF); };
+            using Key= decltype(radixKey(std::invoke(proj, *values)));
+            std::pmr::vector<T> buffer(count, resource);
+            T* from= values;
+            T* to= buffer.data();
+            for(std::size_t shift= 0; shift< sizeof(Key)* 8; shift+= 8){
+                std::size_t offsets[256]= {};
+                for(std::size_t i= 0; i< count; ++i){
+                    ++offsets[digit(from[i], shift)];
+                }
+                if(offsets[digit(from[0], shift)]== count){
+                    continue; //All the elements have this byte the same, the pass would not move anything
+                }
+                std::size_t total= 0;
+                for(std::size_t& offset: offsets){
+                    std::size_t digits= offset;
+                    offset= total;
+                    total+= digits;
+                }
+                for(std::size_t i= 0; i< count; ++i){
+                    to[offsets[digit(from[i], shift)]++]= std::move(from[i]);
+                }
+                std::swap(from, to);
+            }
+            if(from!= values){
+                std::move(from, from+ count, values);
+            }
+        }
+
+        //Comparators that sort in the natural ascending order of the key
+        template<typename Compare, typename Key>
+        constexpr bool isLess= std::is_same_v<Compare, std::ranges::less> || std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<Key>>;
+
+        //The value of a radix key, the inverse of radixKey
+        template<typename T, typename Key>
+        T fromRadixKey(Key key){
+            if constexpr(std::is_integral_v<T>){
+                if constexpr(std::is_signed_v<T>){
+                    key^= Key(1)<< (sizeof(Key)* 8- 1);
+                }
+                return static_cast<T>(key);
+            }
+            else{
+                Key sign= Key(1)<< (sizeof(Key)* 8- 1);
+                return std::bit_cast<T>((key& sign)? Key(key^ sign): Key(~key));
+            }
+        }
+
+        //Call step(i, j) for each compare-exchange of Batcher's network for size elements. The i+ j+ k< size bound makes it a network for any
+        //size, not only a power of 2, so a range is sorted without padding.
+        template<typename Step>
+        constexpr void batcherSteps(std::size_t size, Step step){
+            for(std::size_t p= 1; p< size; p<<= 1){
+                for(std::size_t k= p; k>= 1; k>>= 1){
+                    for(std::size_t j= k% p; j+ k< size; j+= 2* k){
+                        for(std::size_t i= 0; i< k && i+ j+ k< size; ++i){
+                            if((i+ j)/ (2* p)== (i+ j+ k)/ (2* p)){
+                                step(i+ j, i+ j+ k);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        template<std::size_t Size>
+        constexpr std::size_t networkLength(){
+            std::size_t count= 0;
+            batcherSteps(Size, [&count](std::size_t, std::size_t){ ++count; });
+            return count;
+        }
+
+        //The compare-exchange steps of the network as pairs of positions, made by the compiler
+        template<std::size_t Size>
+        constexpr auto network(){
+            std::array<std::pair<uint8_t, uint8_t>, networkLength<Size>()> steps{};
+            std::size_t at= 0;
+            batcherSteps(Size, [&steps, &at](std::size_t i, std::size_t j){
+                steps[at++]= {static_cast<uint8_t>(i), static_cast<uint8_t>(j)};
+            });
+            return steps;
+        }
+
+        template<std::size_t Size>
+        inline constexpr auto Network= network<Size>();
+
+        //Sort Size keys in place with the network. Each step is a swap (a select on b< a, without a branch), so every key is kept.
+        template<typename Key, std::size_t Size>
+        void networkSort(Key* keys){
+            for(const auto& [i, j]: Network<Size>){
+                Key a= keys[i];
+                Key b= keys[j];
+                bool swap= b< a;
+                keys[i]= swap? b: a;
+                keys[j]= swap? a: b;
+            }
+        }
+
+        //networkSort of each size from 0 to NetworkLimit, indexed by the size
+        template<typename Key, std::size_t... Sizes>
+        constexpr auto networkTable(std::index_sequence<Sizes...>){
+            return std::array<void (*)(Key*), sizeof...(Sizes)>{&networkSort<Key, Sizes>...};
+        }
+
+        //Sort count (at most NetworkLimit) numbers with the network of exactly count keys
+        template<typename RandomIt>
+        void keyNetworkSort(RandomIt first, std::size_t count){
+            using T= typename std::iterator_traits<RandomIt>::value_type;
+            using Key= decltype(radixKey(T()));
+            static constexpr auto table= networkTable<Key>(std::make_index_sequence<NetworkLimit+ 1>());
+            Key keys[NetworkLimit];
+            for(std::size_t i= 0; i< count; ++i){
+                keys[i]= radixKey(first[i]);
+            }
+            table[count](keys);
+            for(std::size_t i= 0; i< count; ++i){
+                first[i]= fromRadixKey<T>(keys[i]);
+            }
+        }
+
+        //8 bytes of the string from position depth as a big-endian number, padded with zero bytes. Keys compare like the bytes of the strings
+        //(string compares chars as unsigned char), so a smaller key means a smaller string, and only equal keys need more work.
+        inline std::uint64_t prefixKey(const std::string& text, std::size_t depth= 0){
+            std::uint64_t key= 0;
+            std::size_t length= text.size()> depth? std::min<std::size_t>(8, text.size()- depth): 0;
+            for(std::size_t i= 0; i< length; ++i){
+                key|= static_cast<std::uint64_t>(static_cast<unsigned char>(text[depth+ i]))<< (56- 8* i);
+            }
+            return key;
+        }
+
+        //Length of the prefix that all count strings share, so the keys are taken where the strings start to differ (every URL starts with
+        //"https://", a key of those 8 bytes would tell nothing)
+        template<typename RandomIt>
+        std::size_t commonPrefix(RandomIt first, std::size_t count){
+            std::size_t length= first[0].size();
+            for(std::size_t i= 1; i< count && length> 0; ++i){
+                length= static_cast<std::size_t>(std::mismatch(first[0].begin(), first[0].begin()+ length, first[i].begin(), first[i].end()).first-
+                    first[0].begin());
+            }
+            return length;
+        }
+
+        //Whether the keys at depth tell most strings apart, guessed from the keys of PrefixSample strings spread over the range. If many
+        //sampled keys repeat (URLs of a few sites), prefixSort would compare most strings as whole strings anyway after its radix passes.
+        template<typename RandomIt>
+        bool distinctPrefixes(RandomIt first, std::size_t count, std::size_t depth){
+            std::uint64_t keys[PrefixSample];
+            for(std::size_t i= 0; i< PrefixSample; ++i){
+                keys[i]= prefixKey(first[i* count/ PrefixSample], depth);
+            }
+            keyNetworkSort(keys, PrefixSample);
+            std::size_t repeats= 0;
+            for(std::size_t i= 1; i< PrefixSample; ++i){
+                repeats+= keys[i]== keys[i- 1];
+            }
+            return repeats<= PrefixSample/ 8;
+        }
+
+        //Prefix key of a string and its position in the range
+        struct PrefixEntry{
+            std::uint64_t key;
+            std::size_t index;
+        };
+
+        //Move the strings of the range into the order of the entries
+        template<typename RandomIt>
+        void applyOrder(RandomIt first, const std::pmr::vector<PrefixEntry>& entries){
+            using T= typename std::iterator_traits<RandomIt>::value_type;
+            std::pmr::vector<T> sorted(entries.get_allocator());
+            sorted.reserve(entries.size());
+            for(const PrefixEntry& entry: entries){
+                sorted.push_back(std::move(first[entry.index]));
+            }
+            std::move(sorted.begin(), sorted.end(), first);
+        }
+
+        //Sort count strings that all share their first depth bytes by (prefix key, index) pairs: the pairs are small and contiguous, so the radix
+        //passes do not touch the characters on the heap at all. Only strings with the same 8 bytes after depth are compared, from depth on.
+        template<typename RandomIt>
+        void prefixSort(RandomIt first, std::size_t count, std::size_t depth, std::pmr::memory_resource* resource){
+            std::pmr::vector<PrefixEntry> entries(count, resource);
+            for(std::size_t i= 0; i< count; ++i){
+                entries[i]= {prefixKey(first[i], depth), i};
+            }
+            radixSort(entries.data(), count, [](const PrefixEntry& entry){ return entry.key; }, resource);
+            for(std::size_t begin= 0; begin< count;){
+                std::size_t end= begin+ 1;
+                while(end< count && entries[end].key== entries[begin].key){
+                    ++end;
+                }
+                if(end- begin> 1){
+                    std::sort(entries.begin()+ begin, entries.begin()+ end, [&first, depth](const PrefixEntry& a, const PrefixEntry& b){
+                        return first[a.index].compare(depth, std::string::npos, first[b.index], depth, std::string::npos)< 0;
+                    });
+                }
+                begin= end;
+            }
+            applyOrder(first, entries);
+        }
+
+        //MSD radix sort of count strings that all share their first depth bytes, 8 bytes of the strings in each level. A level radix sorts the (key, index) pairs of one group of strings
+        //that are equal up to depth by their next 8 bytes. In a group of equal keys, the strings that end inside these 8 bytes come first,
+        //shortest first (they differ only by zero padding), and the longer ones become a group of the next level at depth+ 8. So a long shared
+        //prefix is read once for each string, not once for each comparison. Small groups are finished by comparing from their level. The groups
+        //are kept on an explicit stack, so very long strings can not overflow the call stack.
+        template<typename RandomIt>
+        void msdSort(RandomIt first, std::size_t count, std::size_t depth, std::pmr::memory_resource* resource){
+            std::pmr::vector<PrefixEntry> entries(count, resource);
+            for(std::size_t i= 0; i< count; ++i){
+                entries[i].index= i;
+            }
+            struct Group{
+                std::size_t begin;
+                std::size_t end;
+                std::size_t depth;
+            };
+            std::pmr::vector<Group> groups({{0, count, depth}}, resource);
+            auto length= [&first](const PrefixEntry& entry){ return first[entry.index].size(); };
+            while(!groups.empty()){
+                auto [begin, end, level]= groups.back();
+                groups.pop_back();
+                if(end- begin< StringGroupThreshold){ //All the strings of the group are at least level long
+                    std::sort(entries.begin()+ begin, entries.begin()+ end, [&first, level](const PrefixEntry& a, const PrefixEntry& b){
+                        return first[a.index].compare(level, std::string::npos, first[b.index], level, std::string::npos)< 0;
+                    });
+                    continue;
+                }
+                for(std::size_t i= begin; i< end; ++i){
+                    entries[i].key= prefixKey(first[entries[i].index], level);
+                }
+                radixSort(entries.data()+ begin, end- begin, [](const PrefixEntry& entry){ return entry.key; }, resource);
+                for(std::size_t runBegin= begin; runBegin< end;){
+                    std::size_t runEnd= runBegin+ 1;
+                    while(runEnd< end && entries[runEnd].key== entries[runBegin].key){
+                        ++runEnd;
+                    }
+                    if(runEnd- runBegin> 1){
+                        auto runFirst= entries.begin()+ runBegin;
+                        auto longer= std::partition(runFirst, entries.begin()+ runEnd, [&length, level](const PrefixEntry& entry){
+                            return length(entry)<= level+ 8;
+                        });
+                        std::sort(runFirst, longer, [&length](const PrefixEntry& a, const PrefixEntry& b){ return length(a)< length(b); });
+                        std::size_t next= static_cast<std::size_t>(longer- entries.begin());
+                        if(runEnd- next> 1){
+                            groups.push_back({next, runEnd, level+ 8});
+                        }
+                    }
+                    runBegin= runEnd;
+                }
+            }
+            applyOrder(first, entries);
+        }
+    } //End of namespace sorting
+
+    //Sort [first, last) in ascending order: a sorting network for up to 32 numbers, radix sort for many integers or floating numbers in
+    //contiguous memory, std::sort otherwise
+    template<typename RandomIt>
+    void sortElements(RandomIt first, RandomIt last, std::pmr::memory_resource* resource= std::pmr::get_default_resource()){
+        using T= typename std::iterator_traits<RandomIt>::value_type;
+        std::size_t count= static_cast<std::size_t>(last- first);
+        if constexpr(sorting::hasRadixKey<T>){
+            if(count<= sorting::NetworkLimit){
+                sorting::keyNetworkSort(first, count);
+                return;
+            }
+        }
+        if constexpr(sorting::hasRadixKey<T> && std::contiguous_iterator<RandomIt>){
+            if(count>= sorting::RadixThreshold){
+                sorting::radixSort(std::to_address(first), count, std::identity(), resource);
+                return;
+            }
+        }
+        if constexpr(std::is_same_v<T, std::string>){
+            if(count>= sorting::StringPrefixThreshold){
+                std::size_t depth= sorting::commonPrefix(first, count);
+                if(sorting::distinctPrefixes(first, count, depth)){
+                    if(count>= sorting::StringMsdThreshold){
+                        sorting::msdSort(first, count, depth, resource);
+                    }
+                    else{
+                        sorting::prefixSort(first, count, depth, resource);
+                    }
+                    return;
+                }
+                if(count>= sorting::StringMsdTiesThreshold){
+                    sorting::msdSort(first, count, depth, resource);
+                    return;
+                }
+            }
+        }
+        std::sort(first, last);
+    }
+
+    //Sort [first, last) by comp on proj(element), for a container with its own order (for example case-insensitive strings or absolute values).
+    //With a natural "less" comparator, the identity projection uses the kernels above, and a projection to an integer or floating key uses
+    //radix sort on the key for many elements. Anything else is a comparison sort.
+    template<typename RandomIt, typename Compare, typename Projection>
+    void sortElements(RandomIt first, RandomIt last, Compare comp, Projection proj, std::pmr::memory_resource* resource= std::pmr::get_default_resource()){
+        using T= typename std::iterator_traits<RandomIt>::value_type;
+        using Key= std::remove_cvref_t<std::invoke_result_t<Projection&, const T&>>;
+        if constexpr(std::is_same_v<Projection, std::identity> && sorting::isLess<Compare, Key>){
+            sortElements(first, last, resource);
+        }
+        else{
+            if constexpr(sorting::isLess<Compare, Key> && sorting::hasRadixKey<Key> && std::contiguous_iterator<RandomIt>){
+                std::size_t count= static_cast<std::size_t>(last- first);
+                if(count>= sorting::RadixThreshold){
+                    sorting::radixSort(std::to_address(first), count, proj, resource);
+                    return;
+                }
+            }
+            std::sort(first, last, [&comp, &proj](const T& a, const T& b){ return std::invoke(comp, std::invoke(proj, a), std::invoke(proj, b)); });
+        }
+    }
+} //End of namespace exercise4
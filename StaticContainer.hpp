@@ -0,0 +1,77 @@
+//vanunuraz@gmail.com
+//This header defines "StaticContainer", a fixed table of numbers whose orders are computed at compile time.
+
+//MyContainer can not be built in a constexpr context (it has atomics, a mutex and shared snapshots), so a fixed reference table is kept in a
+//StaticContainer instead: constexpr auto table= StaticContainer(array{7, 15, 6, 1, 2}); Then table.values(OrderKind::MiddleOut) and
+//table.permutation(OrderKind::Ascending) are std::arrays made by the compiler, and the program does not sort anything at run time.
+//toContainer() gives a MyContainer with the same elements whose ascending order is seeded from the compile-time sorted values.
+
+#pragma once
+#include <array>
+#include <numeric>
+#include <type_traits>
+#include "MyContainer.hpp"
+
+namespace exercise4{
+
+    template<typename T, size_t N>
+    class StaticContainer{
+        static_assert(std::is_arithmetic_v<T>, "StaticContainer supports only numbers");
+
+        private:
+            array<T, N> elements;
+            array<size_t, N> sorted{}; //Indexes of the elements in ascending order, computed in the constructor (by the compiler for a constexpr table)
+
+        public:
+            //Equal elements keep their insertion order in the ascending order (constexpr has no stable_sort, so the index breaks the tie)
+            constexpr explicit StaticContainer(const array<T, N>& values): elements(values){
+                std::iota(sorted.begin(), sorted.end(), size_t(0));
+                std::sort(sorted.begin(), sorted.end(), [this](size_t a, size_t b){
+                    return elements[a]< elements[b] || (!(elements[b]< elements[a]) && a< b);
+                });
+            }
+
+            constexpr size_t size() const{
+                return N;
+            }
+
+            constexpr const array<T, N>& insertion() const{
+                return elements;
+            }
+
+            //For each position of the order, the index of its element in insertion order
+            constexpr array<size_t, N> permutation(OrderKind kind) const{
+                array<size_t, N> result{};
+                for(size_t pos= 0; pos< N; ++pos){
+                    switch(kind){
+                        case OrderKind::Ascending: result[pos]= sorted[pos]; break;
+                        case OrderKind::Descending: result[pos]= sorted[N- 1- pos]; break;
+                        case OrderKind::SideCross: result[pos]= sorted[sideCrossIndex(pos, N)]; break;
+                        case OrderKind::MiddleOut: result[pos]= sorted[middleOutIndex(pos, N)]; break;
+                        case OrderKind::Reverse: result[pos]= N- 1- pos; break;
+                        case OrderKind::Insertion: result[pos]= pos; break;
+                    }
+                }
+                return result;
+            }
+
+            //The elements of the order
+            constexpr array<T, N> values(OrderKind kind) const{
+                array<T, N> result{};
+                array<size_t, N> indexes= permutation(kind);
+                for(size_t pos= 0; pos< N; ++pos){
+                    result[pos]= elements[indexes[pos]];
+                }
+                return result;
+            }
+
+            //A runtime container with the same elements, its ascending order is seeded from the sorted values made by the compiler (checked in
+            //O(n)), so the first traversal does not sort
+            MyContainer<T> toContainer() const{
+                MyContainer<T> container(vector<T>(elements.begin(), elements.end()));
+                array<T, N> ascending= values(OrderKind::Ascending);
+                container.seedAscendingOrder(OrderBuffer<T>(ascending.begin(), ascending.end(), container.getResource()));
+                return container;
+            }
+    }; //End of StaticContainer class
+} //End of namespace exercise4
@@ -0,0 +1,96 @@
+//vanunuraz@gmail.com
+//This file measures the sort kernels of SortKernels.hpp against std::sort, for the types, sizes and kinds of strings where sortElements uses
+//them. It is built with optimizations (make bench) and prints the ratio of each case, marking the ones where the kernel was slower, to check
+//that a kernel is used only where it really wins. Timings depend on the machine and its load, so only a wrong order fails the run.
+
+#include "SortKernels.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+using namespace exercise4;
+using namespace std;
+
+//Best time of a few runs of sort on a copy of each array of the input, in milliseconds
+template<typename T, typename Sort>
+double bestTime(const vector<vector<T>>& input, Sort sort){
+    double best= 1e300;
+    for(int run= 0; run< 5; ++run){
+        vector<vector<T>> arrays= input;
+        auto start= chrono::steady_clock::now();
+        for(auto& array: arrays){
+            sort(array);
+        }
+        best= min(best, chrono::duration<double, milli>(chrono::steady_clock::now()- start).count());
+    }
+    return best;
+}
+
+//Compare sortElements with std::sort on arrays made by make and print the ratio. Counts the slower cases in slower, and returns false if the
+//kernel gives another order.
+template<typename T, typename Make>
+bool compare(size_t& slower, const char* name, size_t size, size_t arrays, Make make){
+    vector<vector<T>> input(arrays, vector<T>(size));
+    for(auto& array: input){
+        for(T& value: array){
+            value= make();
+        }
+    }
+    double standard= bestTime(input, [](vector<T>& array){ std::sort(array.begin(), array.end()); });
+    double kernel= bestTime(input, [](vector<T>& array){ sortElements(array.begin(), array.end()); });
+    vector<T> expected= input[0];
+    vector<T> actual= input[0];
+    std::sort(expected.begin(), expected.end());
+    sortElements(actual.begin(), actual.end());
+    bool faster= kernel<= standard;
+    slower+= !faster;
+    printf("%-7s n=%-6zu std::sort %8.2f ms  sortElements %8.2f ms  %5.2fx%s%s\n", name, size, standard, kernel, standard/ kernel,
+        faster? "": "  SLOWER", actual== expected? "": "  WRONG ORDER");
+    return actual== expected;
+}
+
+int main(){
+    mt19937_64 random(42);
+    bool ok= true;
+    size_t slower= 0;
+
+    //Sorting networks: every size that sortElements sorts with a network, 200K arrays of each
+    for(size_t size= 2; size<= sorting::NetworkLimit; ++size){
+        ok&= compare<int>(slower, "int", size, 200000, [&random](){ return static_cast<int>(random()); });
+        ok&= compare<int64_t>(slower, "int64", size, 200000, [&random](){ return static_cast<int64_t>(random()); });
+        ok&= compare<uint8_t>(slower, "uint8", size, 200000, [&random](){ return static_cast<uint8_t>(random()); });
+        ok&= compare<float>(slower, "float", size, 200000, [&random](){ return static_cast<float>(static_cast<int64_t>(random())* 1e-12); });
+        ok&= compare<double>(slower, "double", size, 200000, [&random](){ return static_cast<int64_t>(random())* 1e-9; });
+    }
+
+    //Strings: words, numbered names and URLs of many sites have distinct keys after their common prefix; URLs of a few sites have repeating
+    //keys and are measured from the size where they go to MSD radix sort (below it sortElements uses std::sort for them)
+    auto word= [&random](){
+        string word(3+ random()% 8, 'a');
+        for(char& letter: word){
+            letter= static_cast<char>('a'+ random()% 26);
+        }
+        return word;
+    };
+    const string sites[]= {"www.example.com", "en.wikipedia.org", "github.com", "news.ycombinator.com", "docs.python.org", "www.example.org",
+        "stackoverflow.com", "www.youtube.com"};
+    auto url= [&random, &word, &sites](){
+        string url= "https://"+ sites[random()% 8];
+        for(size_t segments= 1+ random()% 3; segments> 0; --segments){
+            url+= "/"+ word();
+        }
+        return url;
+    };
+    for(size_t size: {size_t(256), size_t(1000), size_t(8000), size_t(20000)}){
+        ok&= compare<string>(slower, "words", size, 400000/ size, word);
+        ok&= compare<string>(slower, "names", size, 400000/ size, [&random](){ return "item_"+ to_string(random()% 1000000); });
+        ok&= compare<string>(slower, "sites", size, 400000/ size, [&word](){ return "https://www."+ word()+ ".com/"+ word(); });
+    }
+    for(size_t size: {sorting::StringMsdTiesThreshold, size_t(8000), size_t(20000)}){
+        ok&= compare<string>(slower, "urls", size, 400000/ size, url);
+    }
+
+    printf("%zu cases slower than std::sort%s\n", slower, ok? "": ", and a kernel gave a wrong order");
+    return ok? 0: 1;
+}
@@ -6,9 +6,18 @@
 //The functionality in this file used to implement the MyContainer class with the required iterators.
 #include <iostream>
 #include "MyContainer.hpp"
+#include "Ingest.hpp"
 using namespace exercise4; //Namespace changed to exercise4 as defined in MyContainer.hpp
 
-int main() {
+//With a file name (./main numbers.txt), the numbers in the file are loaded with the streaming loader instead of the demo values.
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        MyContainer<int> loaded;
+        size_t count = ingestFile(argv[1], loaded);
+        std::cout << "Loaded " << count << " elements from " << argv[1] << std::endl;
+        return 0;
+    }
+
     MyContainer<int> container;
     container.addElement(7);
     container.addElement(15);
@@ -5,9 +5,38 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN //This line is necessary to define the main function for the doctest framework
 #include "doctest.h"
 #include "MyContainer.hpp"
+#include "ConcurrentContainer.hpp"
+#include "ParallelTraversal.hpp"
+#include "MappedStorage.hpp"
+#include "Persistence.hpp"
+#include "Ingest.hpp"
+#include "FastOutput.hpp"
+#include "InlineStorage.hpp"
+#include "StaticContainer.hpp"
+#include <filesystem>
+#include <thread>
 using namespace exercise4;
 using namespace std;
 
+//Memory resource that counts the bytes allocated through it and passes them to its upstream
+struct CountingResource: pmr::memory_resource{
+    pmr::memory_resource* upstream= pmr::new_delete_resource();
+    size_t allocations= 0;
+    size_t bytes= 0;
+
+    void* do_allocate(size_t size, size_t alignment) override{
+        ++allocations;
+        bytes+= size;
+        return upstream->allocate(size, alignment);
+    }
+    void do_deallocate(void* p, size_t size, size_t alignment) override{
+        upstream->deallocate(p, size, alignment);
+    }
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override{
+        return this== &other;
+    }
+};
+
 //Basic functionality test: add elements, remove an element, check size, and exception on removing a non-existent element
 TEST_CASE("Basic functionality on the container"){
     MyContainer<int> c;
@@ -299,3 +328,1043 @@ TEST_CASE("Ascending test on large container"){
     }    
     CHECK(result== expected); //Check if the result matches the expected vectors
 }
+
+//Concurrent container: writers append while readers walk the ascending order under the shared lock. Every reader must see a sorted sequence,
+//and at the end all the elements of all writers must be in the container.
+TEST_CASE("Concurrent container with readers and writers"){
+    ConcurrentContainer<int> c;
+    vector<thread> threads;
+    atomic<bool> readerFailed{false};
+    for(int w= 0; w< 4; ++w){
+        threads.emplace_back([&c, w](){
+            for(int i= 0; i< 500; ++i){
+                c.addElement(w* 1000+ i);
+            }
+        });
+    }
+    for(int r= 0; r< 4; ++r){
+        threads.emplace_back([&c, &readerFailed](){
+            for(int i= 0; i< 50; ++i){
+                vector<int> seen= c.read([](const MyContainer<int>& inner){
+                    return to_vector<int>(inner.begin_ascending_order(), inner.end_ascending_order());
+                });
+                if(!is_sorted(seen.begin(), seen.end())){
+                    readerFailed= true;
+                }
+            }
+        });
+    }
+    for(auto& t: threads){
+        t.join();
+    }
+    CHECK_FALSE(readerFailed);
+    CHECK(c.size()== 2000);
+    CHECK(c.getChanges()== 2000); //One generation step per addElement
+
+    //Iterator created under the lock and used without it: still invalidated by a later write
+    auto it= c.begin_order();
+    c.addElement(-1);
+    CHECK_THROWS_AS(*it, runtime_error);
+}
+
+//Lock-free append log: several producers append at the same time, the snapshot must hold every element exactly once
+TEST_CASE("AppendLog with multiple producers"){
+    AppendLog<int> log;
+    vector<thread> producers;
+    for(int p= 0; p< 8; ++p){
+        producers.emplace_back([&log, p](){
+            for(int i= 0; i< 2000; ++i){
+                log.addElement(p* 2000+ i);
+            }
+        });
+    }
+    for(auto& t: producers){
+        t.join();
+    }
+    CHECK(log.readySize()== 16000);
+    MyContainer<int> snap= log.snapshot();
+    CHECK(snap.size()== 16000);
+    vector<int> all= to_vector<int>(snap.begin_ascending_order(), snap.end_ascending_order());
+    vector<int> expected(16000);
+    for(int i= 0; i< 16000; ++i){
+        expected[i]= i;
+    }
+    CHECK(all== expected); //No missing or duplicated element
+}
+
+//Append log with strings and one producer keeps the insertion order
+TEST_CASE("AppendLog keeps insertion order"){
+    AppendLog<string> log;
+    log.addElement("first");
+    log.addElement("second");
+    log.addElement("third");
+    MyContainer<string> snap= log.snapshot();
+    CHECK(to_vector<string>(snap.begin_order(), snap.end_order())== vector<string>{"first","second","third"});
+}
+
+//Sharded container: threads append to their own shards, the ascending and descending views merge all shards into one sorted sequence
+TEST_CASE("Sharded container merged views"){
+    ShardedContainer<int> c(4);
+    vector<thread> threads;
+    for(int t= 0; t< 4; ++t){
+        threads.emplace_back([&c, t](){
+            for(int i= 0; i< 250; ++i){
+                c.addElement(i* 4+ t);
+            }
+        });
+    }
+    for(auto& t: threads){
+        t.join();
+    }
+    CHECK(c.size()== 1000);
+    vector<int> asc= to_vector<int>(c.begin_ascending_order(), c.end_ascending_order());
+    vector<int> expected(1000);
+    for(int i= 0; i< 1000; ++i){
+        expected[i]= i;
+    }
+    CHECK(asc== expected);
+    vector<int> desc= to_vector<int>(c.begin_descending_order(), c.end_descending_order());
+    CHECK(desc== vector<int>(expected.rbegin(), expected.rend()));
+    CHECK(to_vector<int>(c.begin_order(), c.end_order()).size()== 1000);
+
+    c.remove(500);
+    CHECK(c.size()== 999);
+    CHECK_THROWS(c.remove(500)); //Not in any shard anymore
+
+    auto it= c.begin_ascending_order();
+    auto copy= it;
+    ++copy;
+    CHECK(it!= copy);
+    CHECK(++it== copy); //Same traversal, same number of elements passed
+    CHECK(c.end_ascending_order()== c.end_order()); //The end holds nothing
+    c.addElement(2000); //Changes one shard, the merged iterator throws when it reaches an element of that shard
+    CHECK_THROWS(to_vector<int>(it, c.end_ascending_order()));
+}
+
+//Iterators of the same generation share one snapshot: the data is not copied for each iterator, and a new snapshot is made after a change
+TEST_CASE("Iterators share the snapshot of a generation"){
+    MyContainer<int> c;
+    for(int i: {3,1,2}){
+        c.addElement(i);
+    }
+    auto first= c.snapshot();
+    auto it= c.begin_ascending_order();
+    CHECK(c.snapshot()== first); //Same generation, same snapshot
+    CHECK(&*it== &first->ascending()[0]); //The iterator reads the shared sorted buffer
+    weak_ptr<const OrderSnapshot<int>> old= first;
+    first.reset();
+    c.addElement(4);
+    CHECK(c.snapshot()->getGeneration()== c.getChanges());
+    CHECK_FALSE(old.expired()); //The old iterator still holds the old snapshot
+    it= c.begin_ascending_order();
+    CHECK(old.expired()); //The last holder dropped it, so it was reclaimed
+    CHECK(to_vector<int>(it, c.end_ascending_order())== vector<int>{1,2,3,4});
+}
+
+//Readers without a lock: while a writer appends, readers take the published snapshot and always see a sorted, complete state
+TEST_CASE("Concurrent readers use published snapshots"){
+    ConcurrentContainer<int> c;
+    for(int i= 0; i< 100; ++i){
+        c.addElement(i);
+    }
+    atomic<bool> torn{false};
+    vector<thread> readers;
+    for(int r= 0; r< 4; ++r){
+        readers.emplace_back([&c, &torn](){
+            for(int i= 0; i< 200; ++i){
+                try{
+                    auto it= c.begin_ascending_order();
+                    auto end= c.end_ascending_order();
+                    vector<int> seen= to_vector<int>(it, end);
+                    if(!is_sorted(seen.begin(), seen.end()) || seen.size()< 100){
+                        torn= true;
+                    }
+                }
+                catch(const runtime_error&){} //A writer changed the container between begin and end, try again
+            }
+        });
+    }
+    for(int i= 100; i< 300; ++i){
+        c.addElement(i);
+    }
+    for(auto& t: readers){
+        t.join();
+    }
+    CHECK_FALSE(torn);
+    CHECK(c.size()== 300);
+}
+
+//Order views: split into contiguous parts that cover the whole order, and the parts share the buffer of the snapshot
+TEST_CASE("Order view split"){
+    MyContainer<int> c;
+    for(int i: {5,3,9,1,7}){
+        c.addElement(i);
+    }
+    OrderView<int> view= c.middle_out_order();
+    CHECK(vector<int>(view.begin(), view.end())== to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order()));
+    vector<OrderView<int>> parts= c.ascending_order().split(3);
+    CHECK(parts.size()== 3);
+    vector<int> joined;
+    for(const auto& part: parts){
+        joined.insert(joined.end(), part.begin(), part.end());
+    }
+    CHECK(joined== vector<int>{1,3,5,7,9});
+    CHECK(parts[1].begin()== parts[0].end()); //Contiguous parts of one buffer
+    CHECK(c.ascending_order().split(10).size()== 5); //No empty parts
+    c.addElement(0);
+    CHECK_THROWS_AS(parts[0].begin(), runtime_error); //Views are checked like iterators
+}
+
+//Parallel traversal on a work stealing pool: the sum over all parts is the same as the sequential sum, and exceptions reach the caller
+TEST_CASE("Parallel for each on an order"){
+    MyContainer<double> c;
+    for(int i= 1; i<= 10000; ++i){
+        c.addElement(i* 0.5);
+    }
+    WorkStealingPool pool(4);
+    atomic<long long> sum{0};
+    parallel_for_each(c.ascending_order(), [&sum](double x){
+        sum.fetch_add(static_cast<long long>(x* 2));
+    }, pool);
+    CHECK(sum== 10000LL* 10001/ 2);
+
+    //Aggregate with one local sum for each part
+    atomic<size_t> elements{0};
+    parallel_for_each_range(c.middle_out_order(), [&elements](const OrderView<double>& part){
+        size_t local= 0;
+        for(double x: part){
+            local+= (x> 0);
+        }
+        elements+= local;
+    }, pool);
+    CHECK(elements== 10000);
+
+    CHECK_THROWS_AS(parallel_for_each(c.order(), [](double x){
+        if(x> 100){
+            throw invalid_argument("too big");
+        }
+    }, pool), invalid_argument);
+}
+
+//Lazy generators give the same sequences as the iterators, for odd and even sizes
+TEST_CASE("Lazy generators match the iterators"){
+    for(int size: {0, 1, 2, 5, 6, 9}){
+        MyContainer<int> c;
+        for(int i= 0; i< size; ++i){
+            c.addElement((i* 7)% 11);
+        }
+        CHECK(to_vector<int>(c.lazy_ascending_order().begin(), default_sentinel)== to_vector<int>(c.begin_ascending_order(), c.end_ascending_order()));
+        CHECK(to_vector<int>(c.lazy_descending_order().begin(), default_sentinel)== to_vector<int>(c.begin_descending_order(), c.end_descending_order()));
+        CHECK(to_vector<int>(c.lazy_reverse_order().begin(), default_sentinel)== to_vector<int>(c.begin_reverse_order(), c.end_reverse_order()));
+        CHECK(to_vector<int>(c.lazy_order().begin(), default_sentinel)== to_vector<int>(c.begin_order(), c.end_order()));
+        CHECK(to_vector<int>(c.lazy_side_cross_order().begin(), default_sentinel)== to_vector<int>(c.begin_side_cross_order(), c.end_side_cross_order()));
+        CHECK(to_vector<int>(c.lazy_middle_out_order().begin(), default_sentinel)== to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order()));
+    }
+}
+
+//Generator can stop early, and throws if the container changes during the traversal
+TEST_CASE("Lazy generator early stop and invalidation"){
+    MyContainer<string> c;
+    for(string s: {"apple", "banana", "cherry", "date", "fig"}){
+        c.addElement(s);
+    }
+    vector<string> firstTwo;
+    for(const string& s: c.lazy_middle_out_order()){
+        firstTwo.push_back(s);
+        if(firstTwo.size()== 2){
+            break;
+        }
+    }
+    CHECK(firstTwo== vector<string>{"cherry", "banana"});
+
+    auto gen= c.lazy_side_cross_order();
+    auto it= gen.begin();
+    CHECK(*it== "apple");
+    c.addElement("grape");
+    CHECK_THROWS_AS(++it, runtime_error);
+}
+
+//Memory-mapped storage: the elements stay in the file, so a container opened again on the same file has them at once
+TEST_CASE("Mapped storage keeps the elements in the file"){
+    string path= (filesystem::temp_directory_path()/ "mycontainer_mapped_test.bin").string();
+    filesystem::remove(path);
+    {
+        MyContainer<int, MappedVector<int>> c{MappedVector<int>(path)};
+        for(int i= 3000; i> 0; --i){ //More than the first capacity, so the file grows
+            c.addElement(i);
+        }
+        c.remove(1500);
+        CHECK(c.size()== 2999);
+    }
+    {
+        MyContainer<int, MappedVector<int>> reopened{MappedVector<int>(path)};
+        CHECK(reopened.size()== 2999);
+        auto asc= to_vector<int>(reopened.begin_ascending_order(), reopened.end_ascending_order());
+        CHECK(asc.front()== 1);
+        CHECK(asc.back()== 3000);
+        CHECK(is_sorted(asc.begin(), asc.end()));
+        CHECK(to_vector<int>(reopened.begin_order(), reopened.end_order()).front()== 3000); //Insertion order is kept
+    }
+    CHECK_THROWS_AS(MappedVector<double>{path}, runtime_error); //Different element size
+    auto openFiles= [](){ return distance(filesystem::directory_iterator("/proc/self/fd"), filesystem::directory_iterator()); };
+    auto before= openFiles();
+    for(int i= 0; i< 3; ++i){
+        CHECK_THROWS_AS(MappedVector<double>{path}, runtime_error);
+    }
+    CHECK(openFiles()== before); //A failed open closes the file it opened
+    filesystem::remove(path);
+}
+
+//Binary snapshot: save and load give back the same elements in the same order, for numbers and strings
+TEST_CASE("Binary save and load"){
+    string path= (filesystem::temp_directory_path()/ "mycontainer_snapshot_test.bin").string();
+    {
+        MyContainer<double> c;
+        for(double x: {2.5, -1.0, 1e300, 0.1}){
+            c.addElement(x);
+        }
+        save(c, path);
+        MyContainer<double> loaded= load<double>(path);
+        CHECK(loaded.getElements()== c.getElements());
+        CHECK_THROWS_AS(load<int>(path), runtime_error); //Wrong element type
+    }
+    {
+        MyContainer<string> c;
+        for(string s: {"hello", "", "world", "a longer string than the small buffer"}){
+            c.addElement(s);
+        }
+        save(c, path);
+        MyContainer<string> loaded= load<string>(path);
+        CHECK(to_vector<string>(loaded.begin_order(), loaded.end_order())== c.getElements());
+    }
+    {
+        MyContainer<int> empty;
+        save(empty, path);
+        CHECK(load<int>(path).size()== 0);
+    }
+    {
+        ofstream bad(path, ios::binary | ios::trunc);
+        bad<< "not a snapshot";
+    }
+    CHECK_THROWS_AS(load<int>(path), runtime_error);
+    //A corrupted count in the header (after magic, version and type tag) is refused before anything is allocated
+    auto corruptCount= [&path](uint64_t count){
+        fstream file(path, ios::binary | ios::in | ios::out);
+        file.seekp(16);
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    };
+    MyContainer<string> words;
+    words.addElement("word");
+    save(words, path);
+    corruptCount(UINT64_MAX); //count+ 1 would wrap to 0
+    CHECK_THROWS_AS(load<string>(path), runtime_error);
+    MyContainer<int> numbers;
+    numbers.addElement(7);
+    save(numbers, path);
+    corruptCount(uint64_t(1)<< 40);
+    CHECK_THROWS_AS(load<int>(path), runtime_error);
+    corruptCount(2); //One element more than the file has
+    CHECK_THROWS_AS(load<int>(path), runtime_error);
+    filesystem::remove(path);
+}
+
+//Saved order index: the loaded container has its ascending order ready without sorting, and the side cross / middle out orders are right
+TEST_CASE("Load with a saved order index"){
+    string path= (filesystem::temp_directory_path()/ "mycontainer_index_test.bin").string();
+    MyContainer<string> c;
+    for(string s: {"pear", "apple", "fig", "kiwi", "apple", "banana"}){
+        c.addElement(s);
+    }
+    save(c, path, true);
+    MyContainer<string> loaded= load<string>(path);
+    CHECK(loaded.snapshot()->hasAscending()); //Restored from the file, not sorted yet
+    CHECK(to_vector<string>(loaded.begin_ascending_order(), loaded.end_ascending_order())== to_vector<string>(c.begin_ascending_order(), c.end_ascending_order()));
+    CHECK(to_vector<string>(loaded.begin_side_cross_order(), loaded.end_side_cross_order())== to_vector<string>(c.begin_side_cross_order(), c.end_side_cross_order()));
+    CHECK(to_vector<string>(loaded.begin_middle_out_order(), loaded.end_middle_out_order())== to_vector<string>(c.begin_middle_out_order(), c.end_middle_out_order()));
+
+    save(c, path); //Without the index
+    CHECK_FALSE(load<string>(path).snapshot()->hasAscending());
+
+    //Sorted values that are not in order, or not of the same size, are refused
+    MyContainer<int> numbers;
+    for(int i: {3,1,2}){
+        numbers.addElement(i);
+    }
+    OrderBuffer<int> unsorted{3,1,2};
+    OrderBuffer<int> shorter{1,2};
+    OrderBuffer<int> sorted{1,2,3};
+    CHECK_FALSE(numbers.seedAscendingOrder(unsorted));
+    CHECK_FALSE(numbers.seedAscendingOrder(shorter));
+    CHECK_FALSE(numbers.seedAscendingOrder(OrderBuffer<int>{7,8,9})); //Sorted, but the elements of another container
+    CHECK_FALSE(numbers.seedAscendingOrder(OrderBuffer<int>{1,2,2}));
+    CHECK_FALSE(numbers.snapshot()->hasAscending());
+    CHECK(numbers.seedAscendingOrder(sorted));
+    CHECK(numbers.snapshot()->hasAscending());
+
+    //A corrupted sorted block (still in order) is not used: the last sorted value 3 becomes 100
+    save(numbers, path, true);
+    {
+        fstream file(path, ios::in| ios::out| ios::binary);
+        file.seekp(static_cast<streamoff>(sizeof(persistence::FileHeader)+ 5* sizeof(int)));
+        int corrupted= 100;
+        file.write(reinterpret_cast<const char*>(&corrupted), sizeof(corrupted));
+    }
+    MyContainer<int> corruptedFile= load<int>(path);
+    CHECK_FALSE(corruptedFile.snapshot()->hasAscending());
+    CHECK(to_vector<int>(corruptedFile.begin_ascending_order(), corruptedFile.end_ascending_order())== vector<int>{1,2,3});
+
+    //A sorted order saved in another order (descending) is not used, the loaded container sorts on first use
+    MyContainer<int, vector<int>, ranges::greater> reversed;
+    for(int i: {3,1,2}){
+        reversed.addElement(i);
+    }
+    save(reversed, path, true);
+    MyContainer<int> ascending= load<int>(path);
+    CHECK_FALSE(ascending.snapshot()->hasAscending());
+    CHECK(to_vector<int>(ascending.begin_ascending_order(), ascending.end_ascending_order())== vector<int>{1,2,3});
+    filesystem::remove(path);
+}
+
+//Streaming loader: small blocks so numbers and lines are cut between blocks, and one generation step for each batch
+TEST_CASE("Streaming ingestion"){
+    {
+        stringstream in("12 -7\n  300\t4 55555 6");
+        MyContainer<int> c;
+        CHECK(ingest(in, c, 64)== 6);
+        CHECK(c.getElements()== vector<int>{12, -7, 300, 4, 55555, 6});
+        CHECK(c.getChanges()== 1); //One block, one batch
+    }
+    {
+        string text;
+        vector<double> expected;
+        for(int i= 0; i< 500; ++i){
+            text+= to_string(i* 0.25)+ " ";
+            expected.push_back(i* 0.25);
+        }
+        stringstream in(text);
+        MyContainer<double> c;
+        CHECK(ingest(in, c, 64)== 500);
+        CHECK(c.getElements()== expected);
+        CHECK(c.getChanges()< 500); //Batches, not one step for each element
+    }
+    {
+        stringstream in("first line\nsecond\r\n\nlast without newline");
+        MyContainer<string> c;
+        ingest(in, c, 64);
+        CHECK(c.getElements()== vector<string>{"first line", "second", "", "last without newline"});
+    }
+    {
+        stringstream in("1 2 x3");
+        MyContainer<int> c;
+        CHECK_THROWS_AS(ingest(in, c), invalid_argument);
+    }
+}
+
+//Parallel loader over a mapped file: same elements in the same order as the streaming loader, with one generation step
+TEST_CASE("Parallel chunked file ingestion"){
+    string path= (filesystem::temp_directory_path()/ "mycontainer_parallel_ingest.txt").string();
+    {
+        ofstream out(path);
+        for(int i= 0; i< 20000; ++i){
+            out<< (i* 37)% 1001- 500<< (i% 7== 0? "\n": " ");
+        }
+    }
+    MyContainer<int> sequential;
+    ingestFile(path, sequential);
+    WorkStealingPool pool(4);
+    MyContainer<int> parallel;
+    CHECK(ingestFileParallel(path, parallel, pool, 16)== 20000);
+    CHECK(parallel.getChanges()== 1);
+    CHECK(to_vector<int>(parallel.begin_order(), parallel.end_order())== sequential.getElements());
+
+    {
+        ofstream out(path);
+        out<< "alpha\nbeta\ngamma\ndelta";
+    }
+    MyContainer<string> lines;
+    CHECK(ingestFileParallel(path, lines, pool, 3)== 4);
+    CHECK(to_vector<string>(lines.begin_reverse_order(), lines.end_reverse_order())== vector<string>{"delta", "gamma", "beta", "alpha"});
+    filesystem::remove(path);
+}
+
+//Fast output: same format as operator<< for int and string, any order can be printed, and a small buffer is flushed many times correctly
+TEST_CASE("Buffered fast output"){
+    MyContainer<int> c;
+    for(int i: {7, -15, 6, 1, 2}){
+        c.addElement(i);
+    }
+    stringstream expected, fast;
+    expected<< c;
+    writeContainer(fast, c);
+    CHECK(fast.str()== expected.str());
+
+    stringstream desc;
+    writeOrder(desc, c.descending_order());
+    CHECK(desc.str()== "[7, 6, 2, 1, -15]");
+
+    stringstream empty;
+    writeContainer(empty, MyContainer<int>());
+    CHECK(empty.str()== "[]");
+
+    MyContainer<double> d;
+    d.addElement(0.1);
+    d.addElement(2.5);
+    stringstream doubles;
+    writeOrder(doubles, d.side_cross_order());
+    CHECK(doubles.str()== "[0.1, 2.5]");
+
+    MyContainer<string> words;
+    string longWord(100, 'x');
+    words.addElement("hello");
+    words.addElement(longWord);
+    stringstream out;
+    {
+        BufferedWriter writer(out, 8); //Smaller than one element
+        writer.writeList(words.getStorage().begin(), words.getStorage().end());
+    }
+    CHECK(out.str()== "[hello, "+ longWord+ "]");
+}
+
+//pmr: a container on a fixed arena with no upstream. Every allocation of the storage, the snapshots and the order buffers must come from the
+//arena, otherwise null_memory_resource throws bad_alloc.
+TEST_CASE("Polymorphic allocator for storage and snapshots"){
+    alignas(std::max_align_t) static char memory[1<< 16];
+    pmr::monotonic_buffer_resource arena(memory, sizeof(memory), pmr::null_memory_resource());
+    PmrContainer<int> c(&arena);
+    for(int i: {5, 3, 8, 1}){
+        c.addElement(i);
+    }
+    CHECK(c.getResource()== &arena);
+    CHECK(c.snapshot()->getResource()== &arena);
+    CHECK(to_vector<int>(c.begin_ascending_order(), c.end_ascending_order())== vector<int>{1,3,5,8});
+    CHECK(to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order())== vector<int>{3,5,1,8});
+    CHECK(to_vector<int>(c.begin_reverse_order(), c.end_reverse_order())== vector<int>{1,8,3,5});
+
+    //Only the snapshots on a pool resource, the storage stays a normal vector
+    pmr::unsynchronized_pool_resource pool;
+    MyContainer<string> words(vector<string>{"b", "a"}, &pool);
+    CHECK(words.snapshot()->getResource()== &pool);
+    CHECK(to_vector<string>(words.begin_descending_order(), words.end_descending_order())== vector<string>{"b","a"});
+
+    //The scratch buffers of radix sort and of the string prefix sort come from the resource of the container too: the sort takes more than
+    //the snapshot and the sorted buffer from it, and nothing from the default resource
+    CountingResource counting;
+    PmrContainer<int> numbers(&counting);
+    PmrContainer<string> shortWords(&counting); //Short strings stay inside the string object
+    for(int i= 0; i< 1000; ++i){
+        numbers.addElement((i* 7919)% 1000);
+        shortWords.addElement(to_string((i* 7919)% 1000));
+    }
+    CountingResource defaultCounting;
+    pmr::memory_resource* previous= pmr::set_default_resource(&defaultCounting);
+    size_t before= counting.bytes;
+    OrderView<int> sortedNumbers= numbers.view(OrderKind::Ascending);
+    size_t numberBytes= counting.bytes- before;
+    OrderView<string> sortedWords= shortWords.view(OrderKind::Ascending);
+    size_t wordBytes= counting.bytes- before- numberBytes;
+    pmr::set_default_resource(previous);
+    CHECK(defaultCounting.allocations== 0);
+    CHECK(numberBytes>= 3* 1000* sizeof(int)); //Snapshot, sorted buffer and radix scratch
+    CHECK(wordBytes>= 3* 1000* sizeof(string)+ 1000* sizeof(sorting::PrefixEntry)); //And the (key, index) pairs
+    CHECK(is_sorted(sortedNumbers.begin(), sortedNumbers.end()));
+    CHECK(is_sorted(sortedWords.begin(), sortedWords.end()));
+}
+
+//refresh: rebind an iterator to the new generation. When the iterator was the last holder of its snapshot, the new snapshot reuses the same
+//buffers, so the sorted buffer keeps its address.
+TEST_CASE("Refresh an iterator in place after a change"){
+    MyContainer<int> c;
+    for(int i= 100; i> 0; --i){
+        c.addElement(i);
+    }
+    auto it= c.begin_ascending_order();
+    const int* buffer= &*it;
+    CHECK(*it== 1);
+
+    c.remove(1);
+    CHECK_THROWS_AS(*it, runtime_error);
+    it.refresh(c);
+    CHECK(*it== 2);
+    CHECK(&*it== buffer); //Same buffer, no new allocation
+    size_t count= 0;
+    for(auto end= c.end_ascending_order(); it!= end; ++it){
+        ++count;
+    }
+    CHECK(count== 99);
+
+    //Another iterator still holds the old snapshot: it is not reused, and both stay correct
+    auto first= c.begin_descending_order();
+    auto second= c.begin_descending_order();
+    c.addElement(500);
+    first.refresh(c);
+    CHECK(*first== 500);
+    CHECK_THROWS_AS(*second, runtime_error);
+    second.refresh(c, true);
+    CHECK(second== c.end_descending_order());
+}
+
+//copy_order_into: every order written into a buffer of the caller must match the iterators
+TEST_CASE("Copy an order into a caller buffer"){
+    MyContainer<int> c;
+    for(int i: {7, 15, 6, 1, 2}){
+        c.addElement(i);
+    }
+    vector<int> buffer(c.size());
+    CHECK(c.copy_order_into(OrderKind::Ascending, span<int>(buffer))== 5);
+    CHECK(buffer== vector<int>{1,2,6,7,15});
+    c.copy_order_into(OrderKind::Descending, span<int>(buffer));
+    CHECK(buffer== vector<int>{15,7,6,2,1});
+    c.copy_order_into(OrderKind::SideCross, span<int>(buffer));
+    CHECK(buffer== to_vector<int>(c.begin_side_cross_order(), c.end_side_cross_order()));
+    c.copy_order_into(OrderKind::MiddleOut, span<int>(buffer));
+    CHECK(buffer== to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order()));
+    c.copy_order_into(OrderKind::Reverse, span<int>(buffer));
+    CHECK(buffer== vector<int>{2,1,6,15,7});
+
+    //Output iterator version
+    vector<string> out;
+    MyContainer<string> words(vector<string>{"b", "c", "a"});
+    words.copy_order_into(OrderKind::Insertion, back_inserter(out));
+    words.copy_order_into(OrderKind::MiddleOut, back_inserter(out));
+    CHECK(out== vector<string>{"b","c","a","b","a","c"});
+
+    vector<int> small(2);
+    CHECK_THROWS_AS(c.copy_order_into(OrderKind::Ascending, span<int>(small)), invalid_argument);
+
+    //Without a sorted snapshot, ascending and descending are sorted in the caller's buffer: the only memory taken from the container's
+    //resource is the scratch buffer of radix sort, not a snapshot and a sorted copy
+    CountingResource counting;
+    vector<int> many(100000);
+    for(size_t i= 0; i< many.size(); ++i){
+        many[i]= static_cast<int>((i* 7919)% 100003);
+    }
+    MyContainer<int> large(many, &counting);
+    vector<int> ascending(many.size());
+    large.copy_order_into(OrderKind::Ascending, span<int>(ascending));
+    CHECK(counting.bytes<= many.size()* sizeof(int));
+    CHECK(is_sorted(ascending.begin(), ascending.end()));
+    vector<int> descending(many.size());
+    large.copy_order_into(OrderKind::Descending, descending.data());
+    CHECK(descending== vector<int>(ascending.rbegin(), ascending.rend()));
+    CHECK(counting.bytes<= 2* many.size()* sizeof(int));
+    CHECK(to_vector<int>(large.begin_ascending_order(), large.end_ascending_order())== ascending);
+}
+
+//Small buffer: up to 16 elements inside the object, and snapshots from an arena with no upstream, so any heap allocation would throw bad_alloc
+TEST_CASE("Inline storage for small containers"){
+    InlineArena<2048> arena(pmr::null_memory_resource());
+    SmallContainer<int> c(InlineVector<int>{}, &arena);
+    for(int i: {7, 15, 6, 1, 2}){
+        c.addElement(i);
+    }
+    CHECK(c.getStorage().isLocal());
+    CHECK(to_vector<int>(c.begin_ascending_order(), c.end_ascending_order())== vector<int>{1,2,6,7,15});
+    CHECK(to_vector<int>(c.begin_side_cross_order(), c.end_side_cross_order())== vector<int>{1,15,2,7,6});
+    c.remove(15);
+    CHECK(to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order())== vector<int>{2,6,1,7});
+    CHECK(to_vector<int>(c.begin_reverse_order(), c.end_reverse_order())== vector<int>{2,1,6,7});
+
+    //More than N elements go to the heap, strings too
+    SmallContainer<string, 2> words;
+    words.addElement("b");
+    words.addElement("c");
+    CHECK(words.getStorage().isLocal());
+    words.addElement("a");
+    CHECK(!words.getStorage().isLocal());
+    SmallContainer<string, 2> moved(std::move(words));
+    CHECK(to_vector<string>(moved.begin_ascending_order(), moved.end_ascending_order())== vector<string>{"a","b","c"});
+    moved.remove("c");
+    CHECK(to_vector<string>(moved.begin_order(), moved.end_order())== vector<string>{"b","a"});
+
+    //Alignments above max_align_t are aligned on the real address
+    InlineArena<1024> aligned(pmr::null_memory_resource());
+    CHECK(aligned.allocate(1, 1)!= nullptr); //Moves the offset off the start of the buffer
+    for(size_t alignment: {size_t(64), size_t(128), size_t(256)}){
+        void* p= aligned.allocate(8, alignment);
+        CHECK(reinterpret_cast<uintptr_t>(p)% alignment== 0);
+    }
+}
+
+//Compile-time orders: the static_asserts fail the build if the orders are wrong
+TEST_CASE("Orders of a constexpr table"){
+    constexpr StaticContainer table(array{7, 15, 6, 1, 2});
+    static_assert(table.values(OrderKind::Ascending)== array{1, 2, 6, 7, 15});
+    static_assert(table.values(OrderKind::SideCross)== array{1, 15, 2, 7, 6});
+    static_assert(table.values(OrderKind::MiddleOut)== array{6, 2, 7, 1, 15});
+    static_assert(table.permutation(OrderKind::Ascending)== array<size_t, 5>{3, 4, 2, 0, 1});
+    static_assert(table.permutation(OrderKind::Reverse)== array<size_t, 5>{4, 3, 2, 1, 0});
+
+    constexpr StaticContainer doubles(array{2.5, -1.0, 2.5});
+    static_assert(doubles.values(OrderKind::Descending)== array{2.5, 2.5, -1.0});
+    static_assert(doubles.permutation(OrderKind::Ascending)== array<size_t, 3>{1, 0, 2}); //Equal elements keep the insertion order
+
+    MyContainer<int> c= table.toContainer();
+    CHECK(c.snapshot()->hasAscending()); //Seeded, not sorted
+    CHECK(to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order())== vector<int>{6,2,7,1,15});
+}
+
+//Sorting networks: every size up to past the network limit, with duplicates and negative numbers, must give the same result as std::sort
+TEST_CASE("Sorting networks for small ranges"){
+    unsigned seed= 12345;
+    auto next= [&seed](){ seed= seed* 1103515245u+ 12345u; return static_cast<int>((seed>> 16)% 41)- 20; };
+    for(size_t size= 0; size<= 40; ++size){
+        vector<int> ints(size);
+        vector<double> doubles(size);
+        for(size_t i= 0; i< size; ++i){
+            ints[i]= next();
+            doubles[i]= next()* 0.5;
+        }
+        vector<int> expectedInts= ints;
+        vector<double> expectedDoubles= doubles;
+        sort(expectedInts.begin(), expectedInts.end());
+        sort(expectedDoubles.begin(), expectedDoubles.end());
+        sortElements(ints.begin(), ints.end());
+        sortElements(doubles.begin(), doubles.end());
+        CHECK(ints== expectedInts);
+        CHECK(doubles== expectedDoubles);
+    }
+    vector<int> extremes{INT_MAX, 0, INT_MIN, INT_MAX, -1};
+    sortElements(extremes.begin(), extremes.end());
+    CHECK(extremes== vector<int>{INT_MIN, -1, 0, INT_MAX, INT_MAX});
+
+    MyContainer<double> c;
+    for(double d: {2.5, -1.0, 7.25, 0.0}){
+        c.addElement(d);
+    }
+    CHECK(to_vector<double>(c.begin_descending_order(), c.end_descending_order())== vector<double>{7.25, 2.5, 0.0, -1.0});
+
+    //A NaN is kept like any other element, the other elements are still in order
+    MyContainer<double> withNan;
+    for(double d: {numeric_limits<double>::quiet_NaN(), 1.0, 2.0}){
+        withNan.addElement(d);
+    }
+    auto sorted= withNan.ascending_order();
+    CHECK(count_if(sorted.begin(), sorted.end(), [](double d){ return std::isnan(d); })== 1);
+    CHECK(count(sorted.begin(), sorted.end(), 1.0)== 1);
+    CHECK(count(sorted.begin(), sorted.end(), 2.0)== 1);
+    vector<uint8_t> bytes{200, 3, 255, 0, 3, 17, 128};
+    sortElements(bytes.begin(), bytes.end());
+    CHECK(bytes== vector<uint8_t>{0, 3, 3, 17, 128, 200, 255});
+}
+
+//Order policy written by the user: insertion order rotated left by one
+struct RotatedOrder{
+    template<typename T>
+    static const OrderBuffer<T>& source(const OrderSnapshot<T>& snapshot){ return snapshot.insertion(); }
+    static constexpr size_t index(size_t pos, size_t size){ return (pos+ 1)% size; }
+};
+
+//All the orders are one iterator template: post-increment returns the same type, and a user-defined policy gets the same iterator
+TEST_CASE("Order policies on one iterator template"){
+    MyContainer<int> c;
+    for(int i: {7, 15, 6, 1, 2}){
+        c.addElement(i);
+    }
+    auto it= c.begin_descending_order();
+    static_assert(std::is_same_v<decltype(it++), MyContainer<int>::DescendingOrder>);
+    static_assert(std::is_same_v<MyContainer<int>::SideCrossOrder, OrderIterator<int, orders::SideCross>>);
+    auto old= it++;
+    CHECK(*old== 15);
+    CHECK(*it== 7);
+
+    vector<int> rotated= to_vector<int>(OrderIterator<int, RotatedOrder>(c), OrderIterator<int, RotatedOrder>(c, true));
+    CHECK(rotated== vector<int>{15,6,1,2,7});
+    using Rotated= OrderIterator<int, RotatedOrder>;
+    CHECK_THROWS_AS(*Rotated(c, true), out_of_range);
+    c.addElement(3);
+    CHECK_THROWS_AS(*it, runtime_error);
+
+    //Value-initialized iterators compare equal, as forward iterators require
+    static_assert(std::random_access_iterator<MyContainer<int>::AscendingOrder>);
+    MyContainer<int>::AscendingOrder a, b;
+    CHECK(a== b);
+    CHECK_FALSE(a!= b);
+    CHECK_FALSE(a== c.begin_ascending_order());
+}
+
+//Custom orders from index functors: strided and bit-reversed over the insertion order, interleaved halves over the sorted buffer. The
+//iterators are random access.
+TEST_CASE("Custom orders from index functors"){
+    MyContainer<int> c;
+    for(int i= 0; i< 8; ++i){
+        c.addElement(i* 10);
+    }
+    auto strided= [](size_t pos, size_t size){ return pos* 3% size; };
+    CHECK(to_vector<int>(c.begin_custom_order(strided), c.end_custom_order(strided))== vector<int>{0,30,60,10,40,70,20,50});
+
+    auto bitReversed= [](size_t pos, size_t){ //8 elements, 3 bits
+        return ((pos& 1)<< 2)| (pos& 2)| ((pos& 4)>> 2);
+    };
+    CHECK(to_vector<int>(c.begin_custom_order(bitReversed), c.end_custom_order(bitReversed))== vector<int>{0,40,20,60,10,50,30,70});
+
+    MyContainer<int> d;
+    for(int i: {5, 1, 4, 2, 3, 6}){
+        d.addElement(i);
+    }
+    auto interleaved= [](size_t pos, size_t size){ return pos%2== 0? pos/ 2: size/ 2+ pos/ 2; }; //Sorted halves, one from each in turn
+    auto first= d.begin_custom_order(interleaved, true);
+    auto last= d.end_custom_order(interleaved, true);
+    CHECK(to_vector<int>(first, last)== vector<int>{1,4,2,5,3,6});
+
+    //Random access
+    static_assert(std::random_access_iterator<MyContainer<int>::MiddleOutOrder>);
+    static_assert(std::random_access_iterator<decltype(first)>);
+    CHECK(last- first== 6);
+    CHECK(first[3]== 5);
+    CHECK(*(first+ 5)== 6);
+    CHECK(*(last- 1)== 6);
+    CHECK(std::count_if(first, last, [](int x){ return x> 3; })== 3);
+    auto descending= c.begin_descending_order();
+    descending+= 2;
+    CHECK(*descending== 50);
+    CHECK(*--descending== 60);
+
+    //A functor with state (a lambda with a capture, not copy assignable itself) still gives a random access iterator
+    size_t stride= 5;
+    auto stepped= c.begin_custom_order([stride](size_t pos, size_t size){ return pos* stride% size; });
+    static_assert(std::random_access_iterator<decltype(stepped)>);
+    decltype(stepped) other;
+    other= stepped+ 1;
+    CHECK(*other== 50);
+    other= stepped;
+    CHECK(to_vector<int>(other, other+ 8)== vector<int>{0,50,20,70,40,10,60,30});
+
+    auto outside= [](size_t pos, size_t size){ return pos+ size; };
+    CHECK_THROWS_AS(*c.begin_custom_order(outside), out_of_range);
+    d.addElement(7);
+    CHECK_THROWS_AS(first[0], runtime_error);
+}
+
+//Less that counts its calls, to see when a container sorts
+struct CountingLess{
+    static inline size_t calls= 0;
+    bool operator()(int a, int b) const{
+        ++calls;
+        return a< b;
+    }
+};
+
+//view(kind): one view type for an order chosen at run time, the same elements as the iterators of that order
+TEST_CASE("Order chosen at run time with one view type"){
+    MyContainer<int> c;
+    for(int i: {7, 15, 6, 1, 2}){
+        c.addElement(i);
+    }
+    const vector<pair<OrderKind, vector<int>>> expected{
+        {OrderKind::Ascending, to_vector<int>(c.begin_ascending_order(), c.end_ascending_order())},
+        {OrderKind::Descending, to_vector<int>(c.begin_descending_order(), c.end_descending_order())},
+        {OrderKind::SideCross, to_vector<int>(c.begin_side_cross_order(), c.end_side_cross_order())},
+        {OrderKind::MiddleOut, to_vector<int>(c.begin_middle_out_order(), c.end_middle_out_order())},
+        {OrderKind::Reverse, to_vector<int>(c.begin_reverse_order(), c.end_reverse_order())},
+        {OrderKind::Insertion, to_vector<int>(c.begin_order(), c.end_order())}};
+    for(const auto& [kind, elements]: expected){
+        OrderView<int> view= c.view(kind); //The same loop for every order
+        CHECK(vector<int>(view.begin(), view.end())== elements);
+    }
+    CHECK(c.view(OrderKind::MiddleOut).begin()== c.middle_out_order().begin()); //The buffer of the snapshot is shared
+    OrderView<int> view= c.view(OrderKind::Descending);
+    c.addElement(3);
+    CHECK_THROWS_AS(view.begin(), runtime_error);
+
+    //The descending view reverses the cached sorted buffer, it does not sort again
+    MyContainer<int, vector<int>, CountingLess> counted;
+    for(int i: {7, 15, 6, 1, 2}){
+        counted.addElement(i);
+    }
+    counted.view(OrderKind::Ascending);
+    size_t comparisons= CountingLess::calls;
+    OrderView<int> descending= counted.view(OrderKind::Descending);
+    CHECK(CountingLess::calls== comparisons);
+    CHECK(vector<int>(descending.begin(), descending.end())== vector<int>{15,7,6,2,1});
+}
+
+//Any totally ordered type: fixed-width numbers keep the fast sort kernels (radix sort above the threshold), other types use std::sort
+TEST_CASE("Element types beyond int, double and string"){
+    unsigned seed= 777;
+    auto next= [&seed](){ seed= seed* 1103515245u+ 12345u; return seed; };
+    MyContainer<int64_t> big;
+    MyContainer<float> floats;
+    MyContainer<uint8_t> bytes;
+    for(int i= 0; i< 1000; ++i){
+        big.addElement((static_cast<int64_t>(next())<< 20)- (int64_t(1)<< 40));
+        floats.addElement(static_cast<float>(static_cast<int>(next()% 2001)- 1000)/ 8.0f);
+        bytes.addElement(static_cast<uint8_t>(next()));
+    }
+    vector<int64_t> expectedBig= big.getElements();
+    vector<float> expectedFloats= floats.getElements();
+    vector<uint8_t> expectedBytes= bytes.getElements();
+    sort(expectedBig.begin(), expectedBig.end());
+    sort(expectedFloats.begin(), expectedFloats.end());
+    sort(expectedBytes.begin(), expectedBytes.end());
+    CHECK(to_vector<int64_t>(big.begin_ascending_order(), big.end_ascending_order())== expectedBig);
+    CHECK(to_vector<float>(floats.begin_ascending_order(), floats.end_ascending_order())== expectedFloats);
+    CHECK(to_vector<uint8_t>(bytes.begin_ascending_order(), bytes.end_ascending_order())== expectedBytes);
+
+    //A type that is only totally ordered: std::sort path
+    MyContainer<pair<int, string>> pairs;
+    pairs.addElement({2, "b"});
+    pairs.addElement({1, "z"});
+    pairs.addElement({2, "a"});
+    CHECK(to_vector<pair<int, string>>(pairs.begin_ascending_order(), pairs.end_ascending_order())==
+        vector<pair<int, string>>{{1, "z"}, {2, "a"}, {2, "b"}});
+
+    //Snapshot files keep the exact type
+    string path= (filesystem::temp_directory_path()/ "mycontainer_int64.bin").string();
+    save(big, path, true);
+    CHECK(load<int64_t>(path).getElements()== big.getElements());
+    CHECK_THROWS_AS(load<int>(path), runtime_error);
+    save(floats, path);
+    CHECK(load<float>(path).getElements()== floats.getElements());
+    CHECK_THROWS_AS(load<double>(path), runtime_error);
+    filesystem::remove(path);
+}
+
+struct CaseInsensitive{
+    bool operator()(const string& a, const string& b) const{
+        return lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y){ return tolower(x)< tolower(y); });
+    }
+};
+struct AbsoluteValue{
+    double operator()(double x) const{ return x< 0? -x: x; }
+};
+
+//Comparator and projection: they define the sorted orders, the other orders stay by insertion
+TEST_CASE("Custom comparator and projection for the sorted orders"){
+    MyContainer<string, vector<string>, CaseInsensitive> words;
+    for(const char* word: {"banana", "Apple", "cherry", "apricot"}){
+        words.addElement(word);
+    }
+    CHECK(to_vector<string>(words.begin_ascending_order(), words.end_ascending_order())== vector<string>{"Apple","apricot","banana","cherry"});
+    CHECK(to_vector<string>(words.begin_descending_order(), words.end_descending_order())== vector<string>{"cherry","banana","apricot","Apple"});
+    CHECK(to_vector<string>(words.begin_order(), words.end_order())== vector<string>{"banana","Apple","cherry","apricot"});
+
+    MyContainer<double, vector<double>, ranges::less, AbsoluteValue> numbers;
+    for(double d: {-3.0, 1.0, -0.5, 2.0}){
+        numbers.addElement(d);
+    }
+    CHECK(to_vector<double>(numbers.begin_ascending_order(), numbers.end_ascending_order())== vector<double>{-0.5, 1.0, 2.0, -3.0});
+    CHECK(to_vector<double>(numbers.begin_side_cross_order(), numbers.end_side_cross_order())== vector<double>{-0.5, -3.0, 1.0, 2.0});
+
+    //The descending view, the descending copy and the descending iterator are the same sequence, for a projection and for a comparator that
+    //does not agree with the natural order of the elements
+    auto descendingMatches= []<typename T, typename Storage, typename Compare, typename Projection>(const MyContainer<T, Storage, Compare, Projection>& container){
+        vector<T> iterated= to_vector<T>(container.begin_descending_order(), container.end_descending_order());
+        OrderView<T> view= container.view(OrderKind::Descending);
+        vector<T> copied;
+        container.copy_order_into(OrderKind::Descending, back_inserter(copied));
+        return vector<T>(view.begin(), view.end())== iterated && copied== iterated;
+    };
+    CHECK(to_vector<double>(numbers.begin_descending_order(), numbers.end_descending_order())== vector<double>{-3.0, 2.0, 1.0, -0.5});
+    CHECK(descendingMatches(numbers));
+    MyContainer<int, vector<int>, ranges::greater> greatest;
+    for(int i: {7, 15, 6, 1, 2}){
+        greatest.addElement(i);
+    }
+    CHECK(to_vector<int>(greatest.begin_descending_order(), greatest.end_descending_order())== vector<int>{1,2,6,7,15});
+    CHECK(descendingMatches(greatest));
+    CHECK(descendingMatches(words));
+
+    //Integer key: radix sorted by the key, stable, so strings of the same length keep the insertion order
+    auto length= [](const string& s){ return s.size(); };
+    MyContainer<string, vector<string>, ranges::less, decltype(length)> byLength;
+    vector<string> expected;
+    for(int i= 0; i< 300; ++i){
+        string word(static_cast<size_t>((i* 7)% 13), static_cast<char>('a'+ i% 26));
+        byLength.addElement(word);
+        expected.push_back(word);
+    }
+    stable_sort(expected.begin(), expected.end(), [](const string& a, const string& b){ return a.size()< b.size(); });
+    CHECK(to_vector<string>(byLength.begin_ascending_order(), byLength.end_ascending_order())== expected);
+
+    //The saved order index follows the order of the container
+    string path= (filesystem::temp_directory_path()/ "mycontainer_custom.bin").string();
+    save(words, path, true);
+    auto loaded= load<string, MyContainer<string, vector<string>, CaseInsensitive>>(path);
+    CHECK(loaded.snapshot()->hasAscending());
+    CHECK(to_vector<string>(loaded.begin_ascending_order(), loaded.end_ascending_order())== vector<string>{"Apple","apricot","banana","cherry"});
+    filesystem::remove(path);
+}
+
+//Prefix key sort of strings: shared prefixes longer than the key, embedded zero bytes, bytes above 127, empty strings and duplicates must give
+//the same order as std::sort
+TEST_CASE("Prefix key sort of strings"){
+    vector<string> words;
+    unsigned seed= 99;
+    auto next= [&seed](){ seed= seed* 1103515245u+ 12345u; return seed>> 16; };
+    for(int i= 0; i< 500; ++i){
+        string word= (i% 3== 0)? "https://example.com/": "";
+        size_t length= next()% 12;
+        for(size_t j= 0; j< length; ++j){
+            word.push_back(static_cast<char>("ab\0\xff"[next()% 4]));
+        }
+        words.push_back(word);
+    }
+    words.push_back("");
+    words.push_back(string("ab\0", 3));
+    words.push_back("ab");
+    vector<string> expected= words;
+    sort(expected.begin(), expected.end());
+    vector<string> sorted= words;
+    sortElements(sorted.begin(), sorted.end());
+    CHECK(sorted== expected);
+
+    MyContainer<string> c(words);
+    CHECK(to_vector<string>(c.begin_ascending_order(), c.end_ascending_order())== expected);
+    CHECK(to_vector<string>(c.begin_descending_order(), c.end_descending_order())== vector<string>(expected.rbegin(), expected.rend()));
+}
+
+//Strings that all share a long prefix are keyed after it: some strings are the bare prefix, and URLs of a few sites (keys that repeat) are
+//sorted by std::sort below the ties threshold and by MSD radix sort above it
+TEST_CASE("Strings with a common prefix"){
+    unsigned seed= 7;
+    auto next= [&seed](){ seed= seed* 1103515245u+ 12345u; return seed>> 16; };
+    auto word= [&next](){
+        string word(next()% 6, 'a');
+        for(char& letter: word){
+            letter= "az\0\xff"[next()% 4];
+        }
+        return word;
+    };
+    const string sites[]= {"github.com", "en.wikipedia.org", "www.example.com"};
+    for(size_t size: {size_t(300), size_t(1000), sorting::StringMsdTiesThreshold+ 100}){
+        vector<string> distinct;
+        vector<string> urls;
+        for(size_t i= 0; i< size; ++i){
+            distinct.push_back("https://www.example.com/"+ word()+ word()+ to_string(next()));
+            urls.push_back("https://"+ sites[next()% 3]+ "/"+ word()+ "/"+ word());
+        }
+        distinct.push_back("https://www.example.com/");
+        urls.push_back("https://");
+        CHECK(sorting::commonPrefix(distinct.begin(), distinct.size())== 24);
+        CHECK(sorting::distinctPrefixes(distinct.begin(), distinct.size(), 24));
+        CHECK_FALSE(sorting::distinctPrefixes(urls.begin(), urls.size(), 8));
+        for(vector<string>* strings: {&distinct, &urls}){
+            vector<string> expected= *strings;
+            sort(expected.begin(), expected.end());
+            sortElements(strings->begin(), strings->end());
+            CHECK(*strings== expected);
+        }
+    }
+}
+
+//MSD radix sort of many strings with long shared prefixes (above the size threshold): strings that end inside a key, duplicates and zero bytes
+TEST_CASE("MSD radix sort of large string containers"){
+    vector<string> paths;
+    unsigned seed= 4242;
+    auto next= [&seed](){ seed= seed* 1103515245u+ 12345u; return seed>> 16; };
+    const string prefixes[]= {"/usr/share/applications/", "/usr/share/applications/org.example.", "/usr/lib/", ""};
+    for(size_t i= 0; i< sorting::StringMsdThreshold+ 1000; ++i){
+        string path= prefixes[next()% 4];
+        size_t length= next()% 20;
+        for(size_t j= 0; j< length; ++j){
+            path.push_back(static_cast<char>("ab/\0"[next()% 4]));
+        }
+        paths.push_back(path);
+    }
+    vector<string> expected= paths;
+    sort(expected.begin(), expected.end());
+    MyContainer<string> c(paths);
+    CHECK(to_vector<string>(c.begin_ascending_order(), c.end_ascending_order())== expected);
+    CHECK(c.copy_order_into(OrderKind::Descending, span<string>(paths))== paths.size());
+    CHECK(paths== vector<string>(expected.rbegin(), expected.rend()));
+}